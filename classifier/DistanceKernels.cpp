@@ -0,0 +1,694 @@
+#include "../include/DistanceKernels.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define DISTANCE_KERNELS_X86 // Vector kernels compiled for each instruction set, chosen at run time
+#endif
+
+namespace
+{
+    // Independent partial sums per dot product: the compiler keeps them in SIMD registers
+    // without having to reorder a floating-point reduction
+    constexpr size_t lanes = 4;
+    static_assert((FeatureMatrix::alignment / sizeof(Scalar)) % lanes == 0, "Row stride must be a multiple of the lane count");
+
+    // Dot products of two rows of a (a0, a1) with two rows of b (b0, b1), over length values.
+    // Every loaded value is used twice; the 16 partial sums stay in registers.
+    void dotTile(const Scalar *a0, const Scalar *a1, const Scalar *b0, const Scalar *b1, size_t length, Accum dots[2][2])
+    {
+        Accum s00[lanes] = {}, s01[lanes] = {}, s10[lanes] = {}, s11[lanes] = {};
+        for (size_t p = 0; p < length; p += lanes)
+        {
+            for (size_t l = 0; l < lanes; ++l)
+            {
+                Accum x0 = a0[p + l], x1 = a1[p + l];
+                Accum y0 = b0[p + l], y1 = b1[p + l];
+                s00[l] += x0 * y0;
+                s01[l] += x0 * y1;
+                s10[l] += x1 * y0;
+                s11[l] += x1 * y1;
+            }
+        }
+
+        dots[0][0] = dots[0][1] = dots[1][0] = dots[1][1] = 0;
+        for (size_t l = 0; l < lanes; ++l)
+        {
+            dots[0][0] += s00[l];
+            dots[0][1] += s01[l];
+            dots[1][0] += s10[l];
+            dots[1][1] += s11[l];
+        }
+    }
+
+    enum class Metric
+    {
+        SquaredL2,
+        L1,
+        Dot
+    };
+
+    // Contribution of one feature to a metric, in the rounding of the portable kernel
+    template <Metric M, typename T>
+    inline Accum term(T x, T y)
+    {
+        if constexpr (M == Metric::Dot)
+        {
+            return Accum(x) * y;
+        }
+        else
+        {
+            Accum diff = x - y;
+            return M == Metric::SquaredL2 ? diff * diff : std::abs(diff);
+        }
+    }
+
+    // Fixed != 0 compiles the kernel for rows of exactly Fixed values (the dimension argument
+    // is ignored): the trip counts are constants, so the loops are unrolled completely
+    template <Metric M, size_t Fixed = 0>
+    Accum portableKernel(const Scalar *a, const Scalar *b, size_t dimension)
+    {
+        if constexpr (Fixed != 0)
+        {
+            dimension = Fixed;
+        }
+        Accum sums[lanes] = {};
+        size_t i = 0;
+        if constexpr (Fixed != 0)
+        {
+#pragma GCC unroll 32
+            for (; i + lanes <= dimension; i += lanes)
+            {
+                for (size_t l = 0; l < lanes; ++l)
+                {
+                    sums[l] += term<M>(a[i + l], b[i + l]);
+                }
+            }
+        }
+        else
+        {
+            for (; i + lanes <= dimension; i += lanes)
+            {
+                for (size_t l = 0; l < lanes; ++l)
+                {
+                    sums[l] += term<M>(a[i + l], b[i + l]);
+                }
+            }
+        }
+        Accum sum = 0.0;
+        for (size_t l = 0; l < lanes; ++l)
+        {
+            sum += sums[l];
+        }
+        for (; i < dimension; ++i)
+        {
+            sum += term<M>(a[i], b[i]);
+        }
+        return sum;
+    }
+
+#ifdef DISTANCE_KERNELS_X86
+    // Each instruction set gets its own copy of the kernel, compiled for it (functions defined
+    // inside a target region may use its intrinsics); only Scalar == Accum is vectorized.
+    // SSE2 and AVX2 finish the last values one by one; AVX-512 loads them with a mask, whose
+    // zeroed lanes add nothing to any of the metrics. Fixed works as in portableKernel.
+
+#pragma GCC push_options
+#pragma GCC target("sse2")
+    namespace sse2
+    {
+        inline __m128d zero(const double *) { return _mm_setzero_pd(); }
+        inline __m128 zero(const float *) { return _mm_setzero_ps(); }
+        inline __m128d load(const double *p) { return _mm_loadu_pd(p); }
+        inline __m128 load(const float *p) { return _mm_loadu_ps(p); }
+        inline __m128d add(__m128d x, __m128d y) { return _mm_add_pd(x, y); }
+        inline __m128 add(__m128 x, __m128 y) { return _mm_add_ps(x, y); }
+        inline __m128d subtract(__m128d x, __m128d y) { return _mm_sub_pd(x, y); }
+        inline __m128 subtract(__m128 x, __m128 y) { return _mm_sub_ps(x, y); }
+        inline __m128d multiplyAdd(__m128d x, __m128d y, __m128d sum) { return _mm_add_pd(_mm_mul_pd(x, y), sum); }
+        inline __m128 multiplyAdd(__m128 x, __m128 y, __m128 sum) { return _mm_add_ps(_mm_mul_ps(x, y), sum); }
+        inline __m128d absolute(__m128d x) { return _mm_andnot_pd(_mm_set1_pd(-0.0), x); }
+        inline __m128 absolute(__m128 x) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), x); }
+        inline double total(__m128d x) { return _mm_cvtsd_f64(_mm_add_sd(x, _mm_unpackhi_pd(x, x))); }
+        inline float total(__m128 x)
+        {
+            __m128 pairs = _mm_add_ps(x, _mm_movehl_ps(x, x));
+            return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+        }
+
+        template <Metric M, typename Vec>
+        inline Vec step(Vec sum, Vec x, Vec y)
+        {
+            if constexpr (M == Metric::Dot)
+            {
+                return multiplyAdd(x, y, sum);
+            }
+            else
+            {
+                Vec diff = subtract(x, y);
+                return M == Metric::SquaredL2 ? multiplyAdd(diff, diff, sum) : add(sum, absolute(diff));
+            }
+        }
+
+        template <Metric M, typename T, size_t Fixed = 0>
+        Accum kernel(const T *a, const T *b, size_t dimension)
+        {
+            using Vec = decltype(load(a));
+            constexpr size_t width = sizeof(Vec) / sizeof(T);
+            if constexpr (Fixed != 0)
+            {
+                dimension = Fixed;
+            }
+            Vec sum0 = zero(a), sum1 = zero(a);
+            size_t i = 0;
+            if constexpr (Fixed != 0)
+            {
+#pragma GCC unroll 16
+                for (; i + 2 * width <= dimension; i += 2 * width)
+                {
+                    sum0 = step<M>(sum0, load(a + i), load(b + i));
+                    sum1 = step<M>(sum1, load(a + i + width), load(b + i + width));
+                }
+            }
+            else
+            {
+                for (; i + 2 * width <= dimension; i += 2 * width)
+                {
+                    sum0 = step<M>(sum0, load(a + i), load(b + i));
+                    sum1 = step<M>(sum1, load(a + i + width), load(b + i + width));
+                }
+            }
+            if (i + width <= dimension)
+            {
+                sum0 = step<M>(sum0, load(a + i), load(b + i));
+                i += width;
+            }
+            Accum sum = total(add(sum0, sum1));
+            for (; i < dimension; ++i)
+            {
+                sum += term<M>(a[i], b[i]);
+            }
+            return sum;
+        }
+    }
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+    namespace avx2
+    {
+        inline __m256d zero(const double *) { return _mm256_setzero_pd(); }
+        inline __m256 zero(const float *) { return _mm256_setzero_ps(); }
+        inline __m256d load(const double *p) { return _mm256_loadu_pd(p); }
+        inline __m256 load(const float *p) { return _mm256_loadu_ps(p); }
+        inline __m256d add(__m256d x, __m256d y) { return _mm256_add_pd(x, y); }
+        inline __m256 add(__m256 x, __m256 y) { return _mm256_add_ps(x, y); }
+        inline __m256d subtract(__m256d x, __m256d y) { return _mm256_sub_pd(x, y); }
+        inline __m256 subtract(__m256 x, __m256 y) { return _mm256_sub_ps(x, y); }
+        inline __m256d multiplyAdd(__m256d x, __m256d y, __m256d sum) { return _mm256_fmadd_pd(x, y, sum); }
+        inline __m256 multiplyAdd(__m256 x, __m256 y, __m256 sum) { return _mm256_fmadd_ps(x, y, sum); }
+        inline __m256d absolute(__m256d x) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), x); }
+        inline __m256 absolute(__m256 x) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), x); }
+        inline double total(__m256d x)
+        {
+            __m128d half = _mm_add_pd(_mm256_castpd256_pd128(x), _mm256_extractf128_pd(x, 1));
+            return _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+        }
+        inline float total(__m256 x)
+        {
+            __m128 half = _mm_add_ps(_mm256_castps256_ps128(x), _mm256_extractf128_ps(x, 1));
+            __m128 pairs = _mm_add_ps(half, _mm_movehl_ps(half, half));
+            return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+        }
+
+        template <Metric M, typename Vec>
+        inline Vec step(Vec sum, Vec x, Vec y)
+        {
+            if constexpr (M == Metric::Dot)
+            {
+                return multiplyAdd(x, y, sum);
+            }
+            else
+            {
+                Vec diff = subtract(x, y);
+                return M == Metric::SquaredL2 ? multiplyAdd(diff, diff, sum) : add(sum, absolute(diff));
+            }
+        }
+
+        // Scalar tail term with an explicit fused multiply-add: left to itself, the compiler may
+        // contract the tail of a fixed-size instantiation and not that of the generic one
+        template <Metric M, typename T>
+        inline Accum tailStep(Accum sum, T x, T y)
+        {
+            if constexpr (M == Metric::L1)
+            {
+                return sum + term<M>(x, y);
+            }
+            else
+            {
+                Accum diff = M == Metric::Dot ? Accum(x) : Accum(x) - y;
+                return std::fma(diff, M == Metric::Dot ? Accum(y) : diff, sum);
+            }
+        }
+
+        template <Metric M, typename T, size_t Fixed = 0>
+        Accum kernel(const T *a, const T *b, size_t dimension)
+        {
+            using Vec = decltype(load(a));
+            constexpr size_t width = sizeof(Vec) / sizeof(T);
+            if constexpr (Fixed != 0)
+            {
+                dimension = Fixed;
+            }
+            Vec sum0 = zero(a), sum1 = zero(a);
+            size_t i = 0;
+            if constexpr (Fixed != 0)
+            {
+#pragma GCC unroll 16
+                for (; i + 2 * width <= dimension; i += 2 * width)
+                {
+                    sum0 = step<M>(sum0, load(a + i), load(b + i));
+                    sum1 = step<M>(sum1, load(a + i + width), load(b + i + width));
+                }
+            }
+            else
+            {
+                for (; i + 2 * width <= dimension; i += 2 * width)
+                {
+                    sum0 = step<M>(sum0, load(a + i), load(b + i));
+                    sum1 = step<M>(sum1, load(a + i + width), load(b + i + width));
+                }
+            }
+            if (i + width <= dimension)
+            {
+                sum0 = step<M>(sum0, load(a + i), load(b + i));
+                i += width;
+            }
+            Accum sum = total(add(sum0, sum1));
+            for (; i < dimension; ++i)
+            {
+                sum = tailStep<M>(sum, a[i], b[i]);
+            }
+            return sum;
+        }
+    }
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+    namespace avx512
+    {
+        inline __m512d zero(const double *) { return _mm512_setzero_pd(); }
+        inline __m512 zero(const float *) { return _mm512_setzero_ps(); }
+        inline __m512d load(const double *p) { return _mm512_loadu_pd(p); }
+        inline __m512 load(const float *p) { return _mm512_loadu_ps(p); }
+        inline __m512d loadPartial(const double *p, size_t count) { return _mm512_maskz_loadu_pd(static_cast<__mmask8>((1u << count) - 1), p); }
+        inline __m512 loadPartial(const float *p, size_t count) { return _mm512_maskz_loadu_ps(static_cast<__mmask16>((1u << count) - 1), p); }
+        inline __m512d add(__m512d x, __m512d y) { return _mm512_add_pd(x, y); }
+        inline __m512 add(__m512 x, __m512 y) { return _mm512_add_ps(x, y); }
+        inline __m512d subtract(__m512d x, __m512d y) { return _mm512_sub_pd(x, y); }
+        inline __m512 subtract(__m512 x, __m512 y) { return _mm512_sub_ps(x, y); }
+        inline __m512d multiplyAdd(__m512d x, __m512d y, __m512d sum) { return _mm512_fmadd_pd(x, y, sum); }
+        inline __m512 multiplyAdd(__m512 x, __m512 y, __m512 sum) { return _mm512_fmadd_ps(x, y, sum); }
+        inline __m512d absolute(__m512d x) { return _mm512_abs_pd(x); }
+        inline __m512 absolute(__m512 x) { return _mm512_abs_ps(x); }
+        // Through memory: the shuffle and cast intrinsics trip -Wuninitialized in GCC 12's headers
+        inline double total(__m512d x)
+        {
+            alignas(64) double lanes[8];
+            _mm512_store_pd(lanes, x);
+            return ((lanes[0] + lanes[4]) + (lanes[1] + lanes[5])) + ((lanes[2] + lanes[6]) + (lanes[3] + lanes[7]));
+        }
+        inline float total(__m512 x)
+        {
+            alignas(64) float lanes[16];
+            _mm512_store_ps(lanes, x);
+            float sum = 0.0f;
+            for (size_t l = 0; l < 8; ++l)
+            {
+                sum += lanes[l] + lanes[l + 8];
+            }
+            return sum;
+        }
+
+        template <Metric M, typename Vec>
+        inline Vec step(Vec sum, Vec x, Vec y)
+        {
+            if constexpr (M == Metric::Dot)
+            {
+                return multiplyAdd(x, y, sum);
+            }
+            else
+            {
+                Vec diff = subtract(x, y);
+                return M == Metric::SquaredL2 ? multiplyAdd(diff, diff, sum) : add(sum, absolute(diff));
+            }
+        }
+
+        template <Metric M, typename T, size_t Fixed = 0>
+        Accum kernel(const T *a, const T *b, size_t dimension)
+        {
+            using Vec = decltype(load(a));
+            constexpr size_t width = sizeof(Vec) / sizeof(T);
+            if constexpr (Fixed != 0)
+            {
+                dimension = Fixed;
+            }
+            Vec sum0 = zero(a), sum1 = zero(a);
+            size_t i = 0;
+            if constexpr (Fixed != 0)
+            {
+#pragma GCC unroll 16
+                for (; i + 2 * width <= dimension; i += 2 * width)
+                {
+                    sum0 = step<M>(sum0, load(a + i), load(b + i));
+                    sum1 = step<M>(sum1, load(a + i + width), load(b + i + width));
+                }
+            }
+            else
+            {
+                for (; i + 2 * width <= dimension; i += 2 * width)
+                {
+                    sum0 = step<M>(sum0, load(a + i), load(b + i));
+                    sum1 = step<M>(sum1, load(a + i + width), load(b + i + width));
+                }
+            }
+            for (; i < dimension; i += width)
+            {
+                size_t count = std::min(width, dimension - i);
+                sum0 = count == width ? step<M>(sum0, load(a + i), load(b + i))
+                                      : step<M>(sum0, loadPartial(a + i, count), loadPartial(b + i, count));
+            }
+            return total(add(sum0, sum1));
+        }
+    }
+#pragma GCC pop_options
+#endif // DISTANCE_KERNELS_X86
+
+    // Row kernels of one instruction set
+    struct RowKernels
+    {
+        SimdLevel level;
+        RowKernel squaredL2;
+        RowKernel manhattanL1;
+        RowKernel dotProduct;
+        RowKernel fixedSquaredL2[std::size(specializedDimensions)]; // squaredL2 for each specialized dimension
+    };
+
+    // Fills the fixed-dimension table: instantiate(std::integral_constant<size_t, D>) returns the
+    // kernel compiled for D
+    template <typename Instantiate, size_t... Index>
+    void fillFixedKernels(RowKernel *table, Instantiate instantiate, std::index_sequence<Index...>)
+    {
+        ((table[Index] = instantiate(std::integral_constant<size_t, specializedDimensions[Index]>())), ...);
+    }
+
+    RowKernels kernelsFor(SimdLevel level)
+    {
+        constexpr auto specialized = std::make_index_sequence<std::size(specializedDimensions)>();
+#ifdef DISTANCE_KERNELS_X86
+        if constexpr (std::is_same<Scalar, Accum>::value)
+        {
+            RowKernels kernels;
+            switch (level)
+            {
+            case SimdLevel::AVX512:
+                kernels = {level, avx512::kernel<Metric::SquaredL2, Scalar>, avx512::kernel<Metric::L1, Scalar>, avx512::kernel<Metric::Dot, Scalar>, {}};
+                fillFixedKernels(kernels.fixedSquaredL2, [](auto fixed)
+                                 { return &avx512::kernel<Metric::SquaredL2, Scalar, decltype(fixed)::value>; }, specialized);
+                return kernels;
+            case SimdLevel::AVX2:
+                kernels = {level, avx2::kernel<Metric::SquaredL2, Scalar>, avx2::kernel<Metric::L1, Scalar>, avx2::kernel<Metric::Dot, Scalar>, {}};
+                fillFixedKernels(kernels.fixedSquaredL2, [](auto fixed)
+                                 { return &avx2::kernel<Metric::SquaredL2, Scalar, decltype(fixed)::value>; }, specialized);
+                return kernels;
+            case SimdLevel::SSE2:
+                kernels = {level, sse2::kernel<Metric::SquaredL2, Scalar>, sse2::kernel<Metric::L1, Scalar>, sse2::kernel<Metric::Dot, Scalar>, {}};
+                fillFixedKernels(kernels.fixedSquaredL2, [](auto fixed)
+                                 { return &sse2::kernel<Metric::SquaredL2, Scalar, decltype(fixed)::value>; }, specialized);
+                return kernels;
+            default:
+                break;
+            }
+        }
+#endif
+        RowKernels kernels = {SimdLevel::Portable, portableKernel<Metric::SquaredL2>, portableKernel<Metric::L1>, portableKernel<Metric::Dot>, {}};
+        fillFixedKernels(kernels.fixedSquaredL2, [](auto fixed)
+                         { return &portableKernel<Metric::SquaredL2, decltype(fixed)::value>; }, specialized);
+        return kernels;
+    }
+
+    // Kernels in use, selected at the first call
+    RowKernels &activeKernels()
+    {
+        static RowKernels kernels = kernelsFor(detectSimdLevel());
+        return kernels;
+    }
+}
+
+/**
+ * @brief Finds the widest instruction set of the row kernels that the CPU supports.
+ *
+ * @return The level, from CPUID (Portable on other architectures).
+ */
+SimdLevel detectSimdLevel()
+{
+#ifdef DISTANCE_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return SimdLevel::AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return SimdLevel::AVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return SimdLevel::SSE2;
+#endif
+    return SimdLevel::Portable;
+}
+
+/**
+ * @brief Returns the instruction set used by the row kernels.
+ *
+ * @return The selected level (Portable when the build does not vectorize the storage type).
+ */
+SimdLevel activeSimdLevel()
+{
+    return activeKernels().level;
+}
+
+/**
+ * @brief Selects the row kernels of a narrower instruction set.
+ *
+ * @param level The requested level; levels the CPU lacks are replaced by the widest supported.
+ * @return The level actually selected.
+ */
+SimdLevel setSimdLevel(SimdLevel level)
+{
+    activeKernels() = kernelsFor(std::min(level, detectSimdLevel()));
+    return activeKernels().level;
+}
+
+/**
+ * @brief Parses the name of an instruction set, as given on the command line.
+ *
+ * @param name One of "portable", "sse2", "avx2" or "avx512".
+ * @return The level.
+ */
+SimdLevel parseSimdLevel(const std::string &name)
+{
+    if (name == "portable")
+        return SimdLevel::Portable;
+    if (name == "sse2")
+        return SimdLevel::SSE2;
+    if (name == "avx2")
+        return SimdLevel::AVX2;
+    if (name == "avx512")
+        return SimdLevel::AVX512;
+    throw std::invalid_argument("Unknown instruction set: " + name);
+}
+
+/**
+ * @brief Returns a readable name for an instruction set.
+ *
+ * @param level The level.
+ * @return Its name, for reports.
+ */
+std::string simdLevelName(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::SSE2:
+        return "SSE2";
+    case SimdLevel::AVX2:
+        return "AVX2";
+    case SimdLevel::AVX512:
+        return "AVX-512";
+    default:
+        return "portable";
+    }
+}
+
+/**
+ * @brief Computes the squared Euclidean distance between two rows.
+ *
+ * @param a The first row.
+ * @param b The second row.
+ * @param dimension The number of values of both rows.
+ * @return The sum of the squared differences.
+ */
+Accum squaredL2(const Scalar *a, const Scalar *b, size_t dimension)
+{
+    return squaredL2Kernel(dimension)(a, b, dimension);
+}
+
+/**
+ * @brief Selects the squaredL2 kernel for rows of one dimension.
+ *
+ * The specialized dimensions have kernels compiled for their exact length, with no loop
+ * control and a tail known at compile time; they add the values in the same order as the
+ * generic kernel, so both return the same distances.
+ *
+ * @param dimension The number of values of the rows.
+ * @return The kernel of the active instruction set for this dimension.
+ */
+RowKernel squaredL2Kernel(size_t dimension)
+{
+    const RowKernels &kernels = activeKernels();
+    for (size_t s = 0; s < std::size(specializedDimensions); ++s)
+    {
+        if (specializedDimensions[s] == dimension)
+        {
+            return kernels.fixedSquaredL2[s];
+        }
+    }
+    return kernels.squaredL2;
+}
+
+/**
+ * @brief Returns the squaredL2 kernel of the active instruction set that takes any dimension.
+ *
+ * @return The kernel that squaredL2Kernel selects for the dimensions with no specialization.
+ */
+RowKernel genericSquaredL2Kernel()
+{
+    return activeKernels().squaredL2;
+}
+
+/**
+ * @brief Computes the Manhattan distance between two rows.
+ *
+ * @param a The first row.
+ * @param b The second row.
+ * @param dimension The number of values of both rows.
+ * @return The sum of the absolute differences.
+ */
+Accum manhattanL1(const Scalar *a, const Scalar *b, size_t dimension)
+{
+    return activeKernels().manhattanL1(a, b, dimension);
+}
+
+/**
+ * @brief Computes the dot product of two rows.
+ *
+ * @param a The first row.
+ * @param b The second row.
+ * @param dimension The number of values of both rows.
+ * @return The sum of the products.
+ */
+Accum dotProduct(const Scalar *a, const Scalar *b, size_t dimension)
+{
+    return activeKernels().dotProduct(a, b, dimension);
+}
+
+/**
+ * @brief Gives contiguous access to the values of a row accessor.
+ *
+ * Kernels need the values in memory: rows normalized on the fly are read once per query into
+ * a buffer of the calling thread, so the kernels run on it for every reference sample.
+ *
+ * @param row The row accessor (size(), operator[] and label).
+ * @return A row over the thread's buffer, valid until the next call on this thread.
+ */
+template <typename Row>
+FeatureRow contiguousRow(const Row &row)
+{
+    thread_local std::vector<Scalar> buffer;
+    buffer.resize(row.size());
+    for (size_t i = 0; i < row.size(); ++i)
+    {
+        buffer[i] = row[i];
+    }
+    return FeatureRow(buffer.data(), row.size(), row.label);
+}
+
+/**
+ * @brief Computes the squared Euclidean norm of each row of a view.
+ *
+ * @param rows The samples.
+ * @return One squared norm per position of the view.
+ */
+std::vector<Accum> squaredNorms(const FeatureView &rows)
+{
+    std::vector<Accum> norms(rows.size());
+    for (size_t i = 0; i < rows.size(); ++i)
+    {
+        norms[i] = dotProduct(rows.data(i), rows.data(i), rows.dimension());
+    }
+    return norms;
+}
+
+/**
+ * @brief Computes the squared distances between two blocks of rows.
+ *
+ * The dot products are computed by tiles of 2 x 2 rows, so every value loaded from memory is
+ * used twice, with independent partial sums that vectorize. The callers choose blocks small
+ * enough for both sides to stay in cache while the tile sweeps them.
+ *
+ * @param a The first set of samples.
+ * @param aBegin First position of the block of a.
+ * @param aEnd Position past the last one of the block of a.
+ * @param aNorms Squared norms of a, indexed by position.
+ * @param b The second set of samples.
+ * @param bBegin First position of the block of b.
+ * @param bEnd Position past the last one of the block of b.
+ * @param bNorms Squared norms of b, indexed by position.
+ * @param out Receives the (aEnd - aBegin) x (bEnd - bBegin) distances, row-major.
+ * @param outStride Distance between the starts of two rows of out.
+ */
+void squaredDistanceBlock(const FeatureView &a, size_t aBegin, size_t aEnd, const Accum *aNorms,
+                          const FeatureView &b, size_t bBegin, size_t bEnd, const Accum *bNorms,
+                          Accum *out, size_t outStride)
+{
+    if (a.dimension() != b.dimension())
+    {
+        throw std::invalid_argument("Feature vectors must have the same size.");
+    }
+
+    size_t length = a.matrix().stride(); // Padded: the extra values are zero on both sides
+    for (size_t i = aBegin; i < aEnd; i += 2)
+    {
+        const Scalar *a0 = a.data(i);
+        const Scalar *a1 = a.data(std::min(i + 1, aEnd - 1)); // Edge tiles repeat the last row
+        for (size_t j = bBegin; j < bEnd; j += 2)
+        {
+            const Scalar *b0 = b.data(j);
+            const Scalar *b1 = b.data(std::min(j + 1, bEnd - 1));
+
+            Accum dots[2][2];
+            dotTile(a0, a1, b0, b1, length, dots);
+
+            for (size_t ti = 0; ti < 2 && i + ti < aEnd; ++ti)
+            {
+                for (size_t tj = 0; tj < 2 && j + tj < bEnd; ++tj)
+                {
+                    Accum distance = aNorms[i + ti] + bNorms[j + tj] - 2 * dots[ti][tj];
+                    out[(i + ti - aBegin) * outStride + (j + tj - bBegin)] = std::max(distance, Accum(0));
+                }
+            }
+        }
+    }
+}
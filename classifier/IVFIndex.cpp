@@ -0,0 +1,142 @@
+#include "../include/IVFIndex.h"
+#include <algorithm>
+#include <cmath>
+#include "../include/KMeansClassifier.h"
+
+/**
+ * @brief Clusters the samples of a view and files each of them in the list of its centroid.
+ *
+ * The centroids come from KMeansClassifier::cluster() (k-means++ initialization with the seed
+ * of the settings, then Lloyd iterations).
+ * Each list holds its own copy of its samples, in the order of the view, so a probed list is
+ * scanned contiguously and add() only grows one list.
+ *
+ * @param data The indexed samples (their positions are returned by the searches).
+ * @param parameters The index settings.
+ */
+void IVFIndex::build(const FeatureView &data, const IVFParameters &parameters)
+{
+    settings = parameters;
+    distanceKernel = squaredL2Kernel(data.dimension());
+    centroids = FeatureMatrix();
+    lists.clear();
+    positions.clear();
+    indexedCount = 0;
+    if (data.empty())
+    {
+        return;
+    }
+
+    size_t listCount = settings.lists > 0 ? settings.lists : static_cast<size_t>(std::sqrt(static_cast<double>(data.size())));
+    listCount = std::max<size_t>(1, std::min(listCount, data.size()));
+    KMeansClassifier kmeans(static_cast<int>(listCount), settings.trainingIterations);
+    kmeans.cluster(data, settings.seed);
+    centroids = kmeans.clusterCenters();
+
+    std::vector<int> assignment(data.size());
+    std::vector<size_t> sizes(centroids.size(), 0);
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        assignment[i] = kmeans.getClosestCentroid(data.row(i));
+        ++sizes[assignment[i]];
+    }
+    lists.assign(centroids.size(), FeatureMatrix(0, data.dimension()));
+    positions.resize(centroids.size());
+    for (size_t list = 0; list < lists.size(); ++list)
+    {
+        lists[list].reserve(sizes[list]);
+        positions[list].reserve(sizes[list]);
+    }
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        lists[assignment[i]].append(data.row(i));
+        positions[assignment[i]].push_back(i);
+    }
+    indexedCount = data.size();
+}
+
+/**
+ * @brief Finds the list of the centroid nearest to a sample.
+ *
+ * @param values The sample's features.
+ * @return The list index (the first one on ties).
+ */
+size_t IVFIndex::nearestList(const Scalar *values) const
+{
+    size_t dimension = centroids.dimension();
+    size_t best = 0;
+    Accum bestDistance = distanceKernel(values, centroids.data(0), dimension);
+    for (size_t list = 1; list < centroids.size(); ++list)
+    {
+        Accum distance = distanceKernel(values, centroids.data(list), dimension);
+        if (distance < bestDistance)
+        {
+            best = list;
+            bestDistance = distance;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief Files one more sample in the list of its nearest centroid.
+ *
+ * The centroids are not moved, so the lists drift from a k-means partition as samples are
+ * added; a rebuild re-clusters them. The cost is one centroid ranking and an amortized O(d)
+ * append to one list.
+ *
+ * @param sample The sample to index.
+ * @param position Its position in the indexed view, returned by the searches.
+ * @return False when the index was built over no sample and has no centroid to file it under.
+ */
+bool IVFIndex::add(const FeatureRow &sample, size_t position)
+{
+    if (centroids.empty())
+    {
+        return false;
+    }
+    size_t list = nearestList(sample.values);
+    lists[list].append(sample);
+    positions[list].push_back(position);
+    ++indexedCount;
+    return true;
+}
+
+/**
+ * @brief Finds approximate nearest neighbours of a query.
+ *
+ * The centroids are ranked by their distance to the query; the samples of the nprobe nearest
+ * lists are compared with the query by the squaredL2 kernel, so the neighbours found have
+ * their exact distances and ties are broken by position as in a full scan.
+ *
+ * @param query The query sample.
+ * @param heap Receives the neighbours found; its size sets their number.
+ */
+template <typename Row>
+void IVFIndex::search(const Row &query, NeighborHeap &heap) const
+{
+    if (empty())
+    {
+        return;
+    }
+
+    thread_local std::vector<std::pair<Accum, size_t>> ranked; // (squared distance, list)
+    FeatureRow values = contiguousRow(query);
+    size_t dimension = centroids.dimension();
+    ranked.resize(centroids.size());
+    for (size_t list = 0; list < centroids.size(); ++list)
+    {
+        ranked[list] = {distanceKernel(values.values, centroids.data(list), dimension), list};
+    }
+    size_t probes = std::min(std::max<size_t>(settings.nprobe, 1), ranked.size());
+    std::partial_sort(ranked.begin(), ranked.begin() + probes, ranked.end());
+
+    for (size_t p = 0; p < probes; ++p)
+    {
+        size_t list = ranked[p].second;
+        for (size_t i = 0; i < lists[list].size(); ++i)
+        {
+            heap.push(distanceKernel(values.values, lists[list].data(i), dimension), positions[list][i]);
+        }
+    }
+}
@@ -4,6 +4,7 @@
 #include <random>
 #include <iostream>
 #include <algorithm>
+#include "../include/DistanceKernels.h"
 
 /**
  * @brief Construct a new KMeansClassifier object
@@ -15,108 +16,6 @@
 KMeansClassifier::KMeansClassifier(int k, int maxIterations, double convergenceThreshold)
     : k(k), maxIterations(maxIterations), convergenceThreshold(convergenceThreshold) {}
 
-/**
- * @brief Normalize the input data using Z-score normalization.
- *
- * This function takes the input data and validates each data point to have the
- * expected feature dimension. It then calculates the mean and standard deviation
- * for each feature and normalizes the data by subtracting the mean and dividing
- * by the standard deviation. Data points with invalid dimension are skipped.
- *
- * @param rawData The input data to be normalized.
- * @return The normalized data.
- */
-std::vector<DataPoint> KMeansClassifier::normalizeData(const std::vector<DataPoint> &rawData)
-{
-    if (rawData.empty())
-    {
-        return rawData;
-    }
-
-    // Find the expected feature dimension by inspecting the first valid data point
-    size_t expectedDim = 0;
-    for (const auto &point : rawData)
-    {
-        if (!point.features.empty())
-        {
-            expectedDim = point.features.size();
-            break;
-        }
-    }
-
-    if (expectedDim == 0)
-    {
-        throw std::runtime_error("Could not determine feature dimension");
-    }
-
-    std::cout << "Expected feature dimension: " << expectedDim << std::endl;
-
-    // Validate data points and keep only those with the expected feature dimension
-    std::vector<DataPoint> normalizedData;
-    for (const auto &point : rawData)
-    {
-        if (point.features.size() == expectedDim)
-        {
-            normalizedData.push_back(point);
-        }
-        else
-        {
-            std::cerr << "Skipping point with incorrect dimension: "
-                      << point.features.size() << " (expected " << expectedDim << ")" << std::endl;
-        }
-    }
-
-    if (normalizedData.empty())
-    {
-        throw std::runtime_error("No valid data points after dimension validation");
-    }
-
-    // Calculate the mean and standard deviation for each feature
-    std::vector<double> means(expectedDim, 0.0);
-    std::vector<double> stdDevs(expectedDim, 0.0);
-
-    // Calculate means
-    for (const auto &point : normalizedData)
-    {
-        for (size_t i = 0; i < expectedDim; ++i)
-        {
-            means[i] += point.features[i];
-        }
-    }
-    for (double &mean : means)
-    {
-        mean /= normalizedData.size();
-    }
-
-    // Calculate standard deviations
-    for (const auto &point : normalizedData)
-    {
-        for (size_t i = 0; i < expectedDim; ++i)
-        {
-            double diff = point.features[i] - means[i];
-            stdDevs[i] += diff * diff;
-        }
-    }
-    for (double &stdDev : stdDevs)
-    {
-        stdDev = std::sqrt(stdDev / normalizedData.size());
-        if (stdDev < 1e-10)
-            stdDev = 1.0; // Prevent division by zero
-    }
-
-    // Normalize the data using Z-score normalization
-    for (auto &point : normalizedData)
-    {
-        for (size_t i = 0; i < expectedDim; ++i)
-        {
-            point.features[i] = (point.features[i] - means[i]) / stdDevs[i];
-        }
-    }
-
-    std::cout << "Normalized " << normalizedData.size() << " data points" << std::endl;
-    return normalizedData;
-}
-
 /**
  * @brief Initializes centroids using the k-means++ method.
  *
@@ -125,54 +24,57 @@ std::vector<DataPoint> KMeansClassifier::normalizeData(const std::vector<DataPoi
  * centroid. The result is a set of centroids that are spread out and cover the input data well.
  *
  * @param data The input data points.
+ * @param generator The random number generator of the draws.
  */
-void KMeansClassifier::initializeCentroids(const std::vector<DataPoint> &data)
+void KMeansClassifier::initializeCentroids(const FeatureView &data, std::mt19937 &generator)
 {
     // Clear any existing centroids and choose the first point randomly
-    centroids.clear();
-    centroids.push_back(data[0].features);
-
-    std::random_device rd;
-    std::mt19937 gen(rd());
+    centroids = FeatureMatrix();
+    centroids.reserve(k);
+    centroids.append(data.row(0));
 
     // Choose subsequent centroids based on the k-means++ method
     while (centroids.size() < static_cast<size_t>(k))
     {
-        std::vector<double> distances(data.size(), std::numeric_limits<double>::max());
+        std::vector<Accum> distances(data.size(), std::numeric_limits<Accum>::max());
 
         // Calculate the distance from each point to the closest centroid
         for (size_t i = 0; i < data.size(); ++i)
         {
-            for (const auto &centroid : centroids)
+            for (size_t c = 0; c < centroids.size(); ++c)
             {
-                distances[i] = std::min(distances[i], computeDistance(data[i].features, centroid));
+                distances[i] = std::min(distances[i], distanceKernel(data.data(i), centroids.data(c), data.dimension()));
             }
         }
 
         // Choose a new centroid with probability proportional to the square of the distance
         std::discrete_distribution<> distribution(distances.begin(), distances.end());
-        centroids.push_back(data[distribution(gen)].features);
+        centroids.append(data.row(distribution(generator)));
     }
 }
 
 /**
- * @brief Trains the K-Means classifier using the input data.
+ * @brief Clusters the input data without labelling the clusters.
  *
- * The training process involves initializing centroids using the k-means++ method,
- * and then iteratively assigning points to clusters and updating centroids until
- * convergence or a maximum number of iterations is reached.
+ * Centroids are initialized with the k-means++ method, then points are iteratively assigned
+ * to clusters and centroids updated until convergence or a maximum number of iterations is
+ * reached. Nothing is printed, so the centroids can back other structures (e.g. the IVF index).
  *
- * @param data The input data points to be used for training.
+ * @param data The input data points to be clustered.
+ * @param seed The seed of the k-means++ draws (the same seed gives the same clusters).
+ * @return The number of iterations performed.
  */
-void KMeansClassifier::train(const std::vector<DataPoint> &data)
+int KMeansClassifier::cluster(const FeatureView &data, unsigned seed)
 {
     if (data.empty())
     {
         throw std::runtime_error("No training data provided");
     }
 
-    // Initialize centroids
-    initializeCentroids(data);
+    // Kernel of this descriptor's dimension, then centroids
+    distanceKernel = squaredL2Kernel(data.dimension());
+    std::mt19937 generator(seed);
+    initializeCentroids(data, generator);
 
     bool converged = false;
     int iteration = 0;
@@ -180,13 +82,13 @@ void KMeansClassifier::train(const std::vector<DataPoint> &data)
     // Iteratively assign points to clusters and update centroids
     while (!converged && iteration < maxIterations)
     {
-        std::vector<std::vector<const DataPoint *>> clusters(k);
+        std::vector<std::vector<size_t>> clusters(k); // Row indices of the points of each cluster
 
         // Assign each point to the closest centroid (cluster)
-        for (const auto &point : data)
+        for (size_t p = 0; p < data.size(); ++p)
         {
-            int closestCluster = getClosestCentroid(point);
-            clusters[closestCluster].push_back(&point);
+            int closestCluster = getClosestCentroid(data.row(p));
+            clusters[closestCluster].push_back(p);
         }
 
         // Update centroids based on assigned points
@@ -196,36 +98,52 @@ void KMeansClassifier::train(const std::vector<DataPoint> &data)
             if (clusters[i].empty())
             {
                 // Reinitialize empty clusters
-                initializeCentroids(data);
+                initializeCentroids(data, generator);
                 converged = false;
                 break;
             }
 
-            std::vector<double> newCentroid(centroids[i].size(), 0.0);
-            for (const DataPoint *point : clusters[i])
+            std::vector<Accum> sums(centroids.dimension(), 0.0);
+            for (size_t p : clusters[i])
             {
-                for (size_t j = 0; j < newCentroid.size(); ++j)
+                const Scalar *features = data.data(p);
+                for (size_t j = 0; j < sums.size(); ++j)
                 {
-                    newCentroid[j] += point->features[j];
+                    sums[j] += features[j];
                 }
             }
-            for (double &value : newCentroid)
+            std::vector<Scalar> newCentroid(sums.size());
+            for (size_t j = 0; j < sums.size(); ++j)
             {
-                value /= clusters[i].size();
+                newCentroid[j] = static_cast<Scalar>(sums[j] / clusters[i].size());
             }
 
             // Check if centroids have converged
-            if (computeDistance(newCentroid, centroids[i]) > convergenceThreshold)
+            if (std::sqrt(squaredL2(newCentroid.data(), centroids.data(i), newCentroid.size())) > convergenceThreshold)
             {
                 converged = false;
             }
-            centroids[i] = std::move(newCentroid);
+            std::copy(newCentroid.begin(), newCentroid.end(), centroids.data(i));
         }
 
         ++iteration;
     }
 
-    std::cout << "Training completed in " << iteration << " iterations." << std::endl;
+    return iteration;
+}
+
+/**
+ * @brief Trains the K-Means classifier using the input data.
+ *
+ * The data is clustered (see cluster(), with a random seed), then each cluster is mapped to
+ * the most common label among its points.
+ *
+ * @param data The input data points to be used for training.
+ */
+void KMeansClassifier::train(const FeatureView &data)
+{
+    int iterations = cluster(data, std::random_device()());
+    std::cout << "Training completed in " << iterations << " iterations." << std::endl;
 
     // Map clusters to labels
     mapClusterToLabels(data);
@@ -241,13 +159,13 @@ void KMeansClassifier::train(const std::vector<DataPoint> &data)
  *
  * @param data The dataset containing the data points with known labels.
  */
-void KMeansClassifier::mapClusterToLabels(const std::vector<DataPoint> &data)
+void KMeansClassifier::mapClusterToLabels(const FeatureView &data)
 {
     clusterToLabel.clear();
     for (int i = 0; i < k; ++i)
     {
         std::map<int, int> labelCount;
-        for (const auto &point : data)
+        for (const FeatureRow point : data)
         {
             int closestCluster = getClosestCentroid(point);
             if (closestCluster == i)
@@ -275,21 +193,25 @@ void KMeansClassifier::mapClusterToLabels(const std::vector<DataPoint> &data)
 /**
  * @brief Returns the index of the centroid closest to the given point.
  *
- * This function iterates over all centroids and calculates the Euclidean distance
- * between the point and each centroid. The index of the centroid with the smallest
- * distance is returned.
+ * This function iterates over all centroids and calculates the squared Euclidean distance
+ * between the point and each centroid (through the squaredL2 kernel selected for the
+ * dimension at training, on the point read once into contiguous memory). The index of the centroid with the smallest distance is
+ * returned.
  *
  * @param point The data point to find the closest centroid for.
+ * @param squaredDistance If not null, receives the squared distance to that centroid.
  * @return The index of the closest centroid.
  */
-int KMeansClassifier::getClosestCentroid(const DataPoint &point) const
+template <typename Row>
+int KMeansClassifier::getClosestCentroid(const Row &point, Accum *squaredDistance) const
 {
+    FeatureRow values = contiguousRow(point);
     int closestIndex = 0;
-    double minDistance = std::numeric_limits<double>::max();
+    Accum minDistance = std::numeric_limits<Accum>::max();
 
     for (size_t i = 0; i < centroids.size(); ++i)
     {
-        double distance = computeDistance(point.features, centroids[i]);
+        Accum distance = distanceKernel(values.values, centroids.data(i), centroids.dimension());
         if (distance < minDistance)
         {
             minDistance = distance;
@@ -297,6 +219,10 @@ int KMeansClassifier::getClosestCentroid(const DataPoint &point) const
         }
     }
 
+    if (squaredDistance)
+    {
+        *squaredDistance = minDistance;
+    }
     return closestIndex;
 }
 
@@ -310,32 +236,10 @@ int KMeansClassifier::getClosestCentroid(const DataPoint &point) const
  * @param point The data point to predict the label for.
  * @return The predicted label for the given data point.
  */
-int KMeansClassifier::predict(const DataPoint &point)
+template <typename Row>
+int KMeansClassifier::predict(const Row &point) const
 {
-    int closestCentroid = getClosestCentroid(point);
-    return clusterToLabel[closestCentroid]; // Return the label mapped to the closest centroid
-}
-
-/**
- * @brief Computes the Euclidean distance between two vectors.
- *
- * This function takes two vectors `a` and `b` and returns the Euclidean distance
- * between them. The Euclidean distance is the square root of the sum of the squares
- * of the differences between corresponding elements of the two vectors.
- *
- * @param a The first vector.
- * @param b The second vector.
- * @return The Euclidean distance between the two vectors.
- */
-double KMeansClassifier::computeDistance(const std::vector<double> &a, const std::vector<double> &b) const
-{
-    double sum = 0.0;
-    for (size_t i = 0; i < a.size(); ++i)
-    {
-        double diff = a[i] - b[i];
-        sum += diff * diff;
-    }
-    return std::sqrt(sum);
+    return predictWithScore(point).first;
 }
 
 /**
@@ -343,14 +247,18 @@ double KMeansClassifier::computeDistance(const std::vector<double> &a, const std
  *
  * This function predicts the label similar to `predict`, but also calculates a score based on
  * the Euclidean distance to the closest centroid. The score is the negative distance,
- * so lower scores indicate a better fit.
+ * so higher scores indicate a better fit.
  *
- * @param point The DataPoint for which the label and score are to be predicted.
+ * @param point The sample for which the label and score are to be predicted.
  * @return A pair consisting of the predicted label and the decision score.
  */
-std::pair<int, double> KMeansClassifier::predictWithScore(const DataPoint &point) const
+template <typename Row>
+std::pair<int, double> KMeansClassifier::predictWithScore(const Row &point) const
 {
-    int closestCentroid = getClosestCentroid(point);
-    double distance = computeDistance(point.features, centroids[closestCentroid]);
-    return {closestCentroid, -distance}; // Return the centroid index and the negative distance (inverse for better score)
+    Accum squaredDistance;
+    int closestCentroid = getClosestCentroid(point, &squaredDistance);
+    Accum distance = std::sqrt(squaredDistance);
+    auto mapped = clusterToLabel.find(closestCentroid);
+    int label = mapped != clusterToLabel.end() ? mapped->second : 0; // Label mapped to the closest centroid
+    return {label, -distance}; // Return the label and the negative distance (inverse for better score)
 }
\ No newline at end of file
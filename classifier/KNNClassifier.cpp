@@ -1,204 +1,762 @@
 #include "../include/KNNClassifier.h"
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <limits>
 #include <iostream>
+#include <numeric>
 #include <random>
 #include <map>
+#include "../include/DistanceKernels.h"
+#include "../include/Parallel.h"
 
 /**
- * @brief Normalizes the feature values of the given dataset using Z-score normalization.
+ * @brief Constructs a KNN classifier.
  *
- * This function computes the mean and standard deviation for each feature across all data points,
- * and then normalizes the feature values for each data point by subtracting the mean and dividing
- * by the standard deviation.
- *
- * @param data The dataset to be normalized.
- * @return A new dataset with normalized feature values.
+ * @param k The number of neighbours that vote (at least 1).
+ * @param index The neighbour search structure built by train().
+ * @param hnswSettings The graph settings, used when the index is HNSW.
+ * @param quantizationSettings The compression settings, used by the int8 and PQ stores.
+ * @param ivfSettings The list settings, used when the index is IVF.
+ * @param prototypes The reduction of the training samples applied by train().
  */
-std::vector<DataPoint> KNNClassifier::normalizeData(const std::vector<DataPoint> &data)
+KNNClassifier::KNNClassifier(int k, NeighborIndexType index, const HNSWParameters &hnswSettings,
+                             const QuantizationParameters &quantizationSettings, const IVFParameters &ivfSettings,
+                             PrototypeSelection prototypes)
+    : k(k), requestedIndex(index), hnswSettings(hnswSettings), quantizationSettings(quantizationSettings),
+      ivfSettings(ivfSettings), prototypes(prototypes)
 {
-    if (data.empty())
-        return {};
-
-    size_t featureCount = data[0].features.size();
-    std::vector<double> mean(featureCount, 0.0);
-    std::vector<double> stdDev(featureCount, 0.0);
+    if (k < 1)
+    {
+        throw std::invalid_argument("K must be at least 1.");
+    }
+}
 
-    // Calculate the means of each feature
-    for (const auto &point : data)
+/**
+ * @brief Trains the KNN classifier by storing the training data.
+ *
+ * This function keeps a view of the provided training data for future use when predicting;
+ * no feature is copied. The rows are ordered by their position in the matrix, so each
+ * brute-force prediction scans the training features forwards. With a prototype selection,
+ * only the selected samples are kept (the view shrinks; the matrix is untouched) and the
+ * compression is reported. If a KD-tree, a ball tree, an HNSW graph, a compressed store, the
+ * early-abandon scan or IVF lists were requested, the structure is built here and its build
+ * time is reported (with the memory of the codes, for a compressed store, and the number of
+ * lists, for IVF). Each kept sample gets the id of its position in data, for remove().
+ *
+ * @param data The training data to be used by the classifier.
+ */
+void KNNClassifier::train(const FeatureView &data)
+{
+    // Same rows as data.sorted(), remembering where each one comes from
+    ids.resize(data.size());
+    std::iota(ids.begin(), ids.end(), 0);
+    std::stable_sort(ids.begin(), ids.end(), [&](size_t a, size_t b)
+                     { return data.index(a) < data.index(b); });
+    trainingData = data.subset(ids); // Save the training data for prediction
+    ownedSamples.reset();
+    if (prototypes != PrototypeSelection::None)
     {
-        for (size_t i = 0; i < featureCount; ++i)
+        auto start = std::chrono::steady_clock::now();
+        std::vector<size_t> kept = selectPrototypes(trainingData, prototypes, k);
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "KNN " << prototypeSelectionName(prototypes) << " kept " << kept.size() << " of "
+                  << trainingData.size() << " training samples in " << elapsed.count() << " ms";
+        if (kept.empty())
+        {
+            std::cout << "; keeping them all instead" << std::endl;
+        }
+        else
         {
-            mean[i] += point.features[i];
+            std::cout << " (" << static_cast<double>(trainingData.size()) / kept.size() << "x smaller)" << std::endl;
+            trainingData = trainingData.subset(kept);
+            for (size_t i = 0; i < kept.size(); ++i)
+            {
+                ids[i] = ids[kept[i]];
+            }
+            ids.resize(kept.size());
         }
     }
-    for (auto &m : mean)
-        m /= data.size(); // Divide by the number of data points to get the mean
+    positionOfId.assign(data.size(), std::string::npos);
+    for (size_t i = 0; i < ids.size(); ++i)
+    {
+        positionOfId[ids[i]] = i;
+    }
+    prepareReferences();
 
-    // Calculate the standard deviations of each feature
-    for (const auto &point : data)
+    activeIndex = requestedIndex;
+    if (activeIndex == NeighborIndexType::Auto)
     {
-        for (size_t i = 0; i < featureCount; ++i)
-        {
-            stdDev[i] += std::pow(point.features[i] - mean[i], 2);
-        }
+        activeIndex = data.dimension() <= kdTreeMaxDimension ? NeighborIndexType::KDTree : NeighborIndexType::BallTree;
+    }
+    if (activeIndex == NeighborIndexType::BruteForce)
+    {
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    buildIndex();
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "KNN " << neighborIndexName(activeIndex) << " built over " << trainingData.size()
+              << " samples (" << trainingData.dimension() << " features) in " << elapsed.count() << " ms";
+    if (activeIndex == NeighborIndexType::Int8 || activeIndex == NeighborIndexType::ProductQuantized)
+    {
+        size_t compressed = activeIndex == NeighborIndexType::Int8 ? int8Store.memoryBytes() : productQuantizer.memoryBytes();
+        std::cout << ", " << compressed << " bytes instead of "
+                  << trainingData.size() * trainingData.dimension() * sizeof(Scalar);
+    }
+    if (activeIndex == NeighborIndexType::IVF)
+    {
+        std::cout << ", " << ivf.listCount() << " lists, " << std::min(ivfSettings.nprobe, ivf.listCount()) << " probed";
+    }
+    std::cout << std::endl;
+}
+
+/**
+ * @brief Prepares the per-sample data of a reference set without tombstone.
+ *
+ * The squared norms (for batches), the distance kernel and the anytime order are recomputed;
+ * every position is live and, once buildIndex() has run, indexed.
+ */
+void KNNClassifier::prepareReferences()
+{
+    trainingNorms = squaredNorms(trainingData);
+    distanceKernel = squaredL2Kernel(trainingData.dimension());
+    buildAnytimeOrder();
+    removed.assign(trainingData.size(), 0);
+    removedCount = 0;
+    indexedCount = trainingData.size();
+}
+
+/**
+ * @brief Builds the active index over the reference samples (nothing for brute force).
+ */
+void KNNClassifier::buildIndex()
+{
+    switch (activeIndex)
+    {
+    case NeighborIndexType::KDTree:
+        kdTree.build(trainingData);
+        break;
+    case NeighborIndexType::BallTree:
+        ballTree.build(trainingData);
+        break;
+    case NeighborIndexType::HNSW:
+        hnsw.build(trainingData, hnswSettings);
+        break;
+    case NeighborIndexType::Int8:
+        int8Store.build(trainingData, quantizationSettings);
+        break;
+    case NeighborIndexType::ProductQuantized:
+        productQuantizer.build(trainingData, quantizationSettings);
+        break;
+    case NeighborIndexType::EarlyAbandon:
+        earlyAbandon.build(trainingData);
+        break;
+    case NeighborIndexType::IVF:
+        ivf.build(trainingData, ivfSettings);
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Adds a reference sample to a trained classifier.
+ *
+ * The first call copies the references into a matrix owned by the classifier; each sample is
+ * then appended to it, with its norm and its tombstone, at an amortized O(d) cost. The HNSW
+ * graph and the IVF lists index the sample at once, and the compressed stores encode it with
+ * their existing ranges or codebooks (retrained only when tombstones trigger a compaction).
+ * The KD-tree, the ball tree and the early-abandon scan are not incremental: they leave the
+ * sample to the brute-force scan of the unindexed tail until a compaction rebuilds them. The
+ * sample comes last in the anytime order.
+ *
+ * @param sample The new sample, normalized like the training data.
+ * @return The id of the sample, for remove().
+ */
+size_t KNNClassifier::add(const FeatureRow &sample)
+{
+    if (trainingData.dimension() == 0)
+    {
+        throw std::runtime_error("KNNClassifier is not trained.");
+    }
+    if (sample.size() != trainingData.dimension())
+    {
+        throw std::invalid_argument("Feature vectors must have the same size.");
+    }
+
+    if (!ownedSamples)
+    {
+        ownedSamples = std::make_unique<FeatureMatrix>(trainingData.materialize());
+        trainingData = FeatureView(*ownedSamples);
+        int8Store.rebind(trainingData); // The compressed stores re-rank from the copy from now on
+        productQuantizer.rebind(trainingData);
     }
-    for (auto &s : stdDev)
-        s = std::sqrt(s / data.size()); // Take the square root to get the standard deviation
+    size_t position = trainingData.size();
+    ownedSamples->append(sample);
+    trainingData.appendIndex(ownedSamples->size() - 1);
+    trainingNorms.push_back(dotProduct(sample.values, sample.values, sample.size()));
+    removed.push_back(0);
+    anytimeOrder.push_back(position);
+    size_t id = positionOfId.size();
+    ids.push_back(id);
+    positionOfId.push_back(position);
 
-    // Normalize the data (Z-score normalization)
-    std::vector<DataPoint> normalizedData = data;
-    for (auto &point : normalizedData)
+    // An index that takes insertions stays complete
+    if (indexedCount == position)
     {
-        for (size_t i = 0; i < featureCount; ++i)
+        if (activeIndex == NeighborIndexType::BruteForce)
         {
-            if (stdDev[i] > 0)
-            {
-                point.features[i] = (point.features[i] - mean[i]) / stdDev[i]; // Normalize the feature
-            }
-            else
-            {
-                point.features[i] = 0.0; // If standard deviation is 0, set the feature to 0
-            }
+            ++indexedCount;
+        }
+        else if (activeIndex == NeighborIndexType::HNSW)
+        {
+            hnsw.add(sample);
+            ++indexedCount;
+        }
+        else if (activeIndex == NeighborIndexType::IVF && ivf.add(sample, position))
+        {
+            ++indexedCount;
+        }
+        else if (activeIndex == NeighborIndexType::Int8)
+        {
+            int8Store.add(sample, ownedSamples->size() - 1);
+            ++indexedCount;
+        }
+        else if (activeIndex == NeighborIndexType::ProductQuantized)
+        {
+            productQuantizer.add(sample, ownedSamples->size() - 1);
+            ++indexedCount;
         }
     }
+    compactIfNeeded();
+    return id;
+}
 
-    return normalizedData;
+/**
+ * @brief Removes a reference sample.
+ *
+ * The sample is only tombstoned: searches skip it, and the next compaction drops it.
+ *
+ * @param id The id of the sample (from its position in the training view, or from add()).
+ * @return False if no live sample has this id.
+ */
+bool KNNClassifier::remove(size_t id)
+{
+    if (id >= positionOfId.size() || positionOfId[id] == std::string::npos)
+    {
+        return false;
+    }
+    removed[positionOfId[id]] = 1;
+    positionOfId[id] = std::string::npos;
+    ++removedCount;
+    compactIfNeeded();
+    return true;
 }
 
 /**
- * @brief Trains the KNN classifier by storing the training data.
+ * @brief Compacts the references once they carry too many tombstones or unindexed samples.
  *
- * This function simply stores the provided training data for future use when predicting.
+ * A quarter of removed samples, or an unindexed tail longer than a quarter of the indexed
+ * samples (and than 64 samples), triggers it; the rebuild cost is thus amortized over as
+ * many updates. Only the KD-tree, the ball tree and the early-abandon scan leave a tail, so
+ * for them an insertion costs a share of a full rebuild (O(d log n) amortized for the trees)
+ * and queries scan up to a quarter more samples linearly.
+ */
+void KNNClassifier::compactIfNeeded()
+{
+    constexpr size_t minimumTail = 64;
+    size_t tail = trainingData.size() - indexedCount;
+    if (removedCount * 4 > trainingData.size() || tail * 4 > std::max(indexedCount, minimumTail))
+    {
+        compact();
+    }
+}
+
+/**
+ * @brief Drops the tombstoned samples and rebuilds the index over the live ones.
  *
- * @param data The training data to be used by the classifier.
+ * The live samples are copied, in their order, into a new owned matrix and keep their ids;
+ * the norms, the anytime order and the index are rebuilt as by train(), without the report.
+ * Nothing happens when no sample is live, so the classifier keeps its index.
  */
-void KNNClassifier::train(const std::vector<DataPoint> &data)
+void KNNClassifier::compact()
 {
-    trainingData = data; // Save the training data for prediction
+    if (referenceCount() == 0)
+    {
+        return;
+    }
+
+    std::vector<size_t> live;
+    live.reserve(referenceCount());
+    for (size_t i = 0; i < trainingData.size(); ++i)
+    {
+        if (!removed[i])
+        {
+            ids[live.size()] = ids[i];
+            positionOfId[ids[i]] = live.size();
+            live.push_back(i);
+        }
+    }
+    ids.resize(live.size());
+
+    auto compacted = std::make_unique<FeatureMatrix>(trainingData.subset(live).materialize());
+    trainingData = FeatureView(*compacted);
+    ownedSamples = std::move(compacted);
+    prepareReferences();
+    buildIndex();
 }
 
 /**
- * @brief Predicts the label for a given test data point.
+ * @brief Finds the k nearest training samples of a test point.
  *
- * This function calculates the distance between the test point and each training point,
- * sorts the distances, and returns the label of the majority of the nearest neighbors.
+ * Every exact index returns the neighbours of a full scan: distances are compared squared
+ * and ties on the distance are broken by the position of the sample. The HNSW graph, the
+ * compressed stores and the IVF lists return approximate neighbours, whose recall depends on
+ * their efSearch, rerank and nprobe settings. The brute-force scan
+ * keeps only the k best candidates in the bounded heap instead of sorting every distance.
  *
- * @param testPoint The DataPoint for which the label is to be predicted.
- * @return The predicted label for the test point.
+ * Removed samples are skipped: with tombstones, the index fills a larger heap (k plus the
+ * number of tombstones) whose live candidates are kept, so an exact index still returns the
+ * exact live neighbours. Samples added since the index was built are then scanned.
+ *
+ * @param testPoint The sample whose neighbours are searched.
+ * @param heap Receives the neighbours as (squared distance, position in trainingData).
  */
-int KNNClassifier::predict(const DataPoint &testPoint) const
+template <typename Row>
+void KNNClassifier::searchNeighbors(const Row &testPoint, NeighborHeap &heap) const
 {
     // Check if the classifier has been trained
     if (trainingData.empty())
     {
         throw std::runtime_error("KNNClassifier is not trained.");
     }
+    if (referenceCount() == 0)
+    {
+        throw std::runtime_error("Every KNNClassifier reference sample was removed.");
+    }
+    // Ensure the feature vectors have the same size
+    if (testPoint.size() != trainingData.dimension())
+    {
+        throw std::invalid_argument("Feature vectors must have the same size.");
+    }
 
-    // Calculate the distance between the test point and each training point
-    std::vector<std::pair<double, int>> distances; // (distance, label)
-    for (const auto &trainPoint : trainingData)
+    // The size was checked above: the kernel of the training dimension runs on every sample
+    const Scalar *query = contiguousRow(testPoint).values;
+    size_t dimension = trainingData.dimension();
+    size_t scanned = 0; // First position left to the brute-force scan
+    if (activeIndex != NeighborIndexType::BruteForce)
     {
-        double distance = calculateDistance(testPoint, trainPoint);
-        distances.emplace_back(distance, trainPoint.label); // Store distance and label
+        thread_local NeighborHeap unfiltered;
+        NeighborHeap *candidates = &heap;
+        if (removedCount > 0)
+        {
+            unfiltered.reset(heap.capacity() + removedCount);
+            candidates = &unfiltered;
+        }
+
+        switch (activeIndex)
+        {
+        case NeighborIndexType::KDTree:
+            kdTree.search(testPoint, *candidates);
+            break;
+        case NeighborIndexType::BallTree:
+            ballTree.search(testPoint, *candidates);
+            break;
+        case NeighborIndexType::HNSW:
+            hnsw.search(testPoint, *candidates);
+            break;
+        case NeighborIndexType::Int8:
+            int8Store.search(testPoint, *candidates);
+            break;
+        case NeighborIndexType::ProductQuantized:
+            productQuantizer.search(testPoint, *candidates);
+            break;
+        case NeighborIndexType::EarlyAbandon:
+            earlyAbandon.search(testPoint, *candidates);
+            break;
+        default:
+            ivf.search(testPoint, *candidates);
+            break;
+        }
+
+        if (candidates != &heap)
+        {
+            for (const Neighbor &candidate : unfiltered.sort())
+            {
+                if (!removed[candidate.second])
+                {
+                    heap.push(candidate.first, candidate.second);
+                }
+            }
+        }
+        scanned = indexedCount;
+    }
+
+    for (size_t i = scanned; i < trainingData.size(); ++i)
+    {
+        if (removedCount == 0 || !removed[i])
+        {
+            heap.push(distanceKernel(query, trainingData.data(i), dimension), i);
+        }
     }
+}
 
-    // Sort the distances in ascending order
-    std::sort(distances.begin(), distances.end());
+/**
+ * @brief Classifies a test point in a single neighbour search.
+ *
+ * The label is the one with the largest inverse-distance weighted vote among the k nearest
+ * neighbors. Distances stay squared during the search; only the k kept ones are square-rooted.
+ * The neighbour heap is reused by the calling thread, so a prediction does not allocate.
+ * A row normalized on the fly is read once into contiguous memory, where the distance kernels
+ * can load it.
+ *
+ * @param testPoint The sample to classify.
+ * @return The label, its share of the weighted vote and the decision score.
+ */
+template <typename Row>
+KNNPrediction KNNClassifier::classify(const Row &testPoint) const
+{
+    thread_local NeighborHeap heap;
+    heap.reset(k);
+    searchNeighbors(contiguousRow(testPoint), heap);
+    return tally(heap.sort());
+}
 
-    // Return the label with the highest frequency among the nearest neighbors
-    std::map<int, double> labelWeightedCounts;
-    for (int i = 0; i < std::min(k, static_cast<int>(distances.size())); ++i)
+/**
+ * @brief Orders the training samples for anytime searches.
+ *
+ * The labels take turns, so a search cut short has seen about as many samples of every label;
+ * within a label, samples come from the nearest to the label's mean outwards, so the typical
+ * ones are compared first. Ties keep the order of the positions.
+ */
+void KNNClassifier::buildAnytimeOrder()
+{
+    size_t dimension = trainingData.dimension();
+    std::map<int, std::vector<size_t>> byLabel;
+    for (size_t i = 0; i < trainingData.size(); ++i)
     {
-        double weight = 1.0 / (distances[i].first + 1e-6);  // Avoid division by 0
-        labelWeightedCounts[distances[i].second] += weight; // Update weighted count for each label
+        byLabel[trainingData.label(i)].push_back(i);
     }
 
-    // Find the label with the maximum weighted count
-    return std::max_element(labelWeightedCounts.begin(), labelWeightedCounts.end(),
-                            [](const auto &a, const auto &b)
-                            { return a.second < b.second; })
-        ->first;
+    std::vector<std::vector<size_t>> groups;
+    for (auto &[label, positions] : byLabel)
+    {
+        std::vector<Accum> sums(dimension, 0.0);
+        for (size_t position : positions)
+        {
+            const Scalar *values = trainingData.data(position);
+            for (size_t j = 0; j < dimension; ++j)
+            {
+                sums[j] += values[j];
+            }
+        }
+        std::vector<Scalar> mean(dimension);
+        for (size_t j = 0; j < dimension; ++j)
+        {
+            mean[j] = static_cast<Scalar>(sums[j] / positions.size());
+        }
+
+        std::vector<Neighbor> ranked; // (squared distance to the mean, position)
+        for (size_t position : positions)
+        {
+            ranked.emplace_back(squaredL2(mean.data(), trainingData.data(position), dimension), position);
+        }
+        std::sort(ranked.begin(), ranked.end());
+        groups.emplace_back();
+        for (const Neighbor &sample : ranked)
+        {
+            groups.back().push_back(sample.second);
+        }
+    }
+
+    anytimeOrder.clear();
+    anytimeOrder.reserve(trainingData.size());
+    for (size_t rank = 0; anytimeOrder.size() < trainingData.size(); ++rank)
+    {
+        for (const std::vector<size_t> &group : groups)
+        {
+            if (rank < group.size())
+            {
+                anytimeOrder.push_back(group[rank]);
+            }
+        }
+    }
 }
 
 /**
- * @brief Calculates the Euclidean distance between two data points.
+ * @brief Classifies a test point within a time or candidate budget.
  *
- * This function calculates the Euclidean distance between the feature vectors of two data points.
- * It assumes that both feature vectors have the same size.
+ * The training samples are compared with the query in anytimeOrder, through the kernel of the
+ * training dimension, until the candidate budget is used or the time budget has elapsed.
+ * Removed samples are skipped without being charged to the budget, so tombstones can neither
+ * use it up nor leave the vote empty. The clock is read every anytimeCheckInterval compared
+ * samples, after the first ones, so a vote always has neighbours. The vote uses the k best neighbours found so far; a completed scan returns
+ * exactly what classify() returns with brute force.
  *
- * @param a The first DataPoint.
- * @param b The second DataPoint.
- * @return The Euclidean distance between the two feature vectors.
+ * @param testPoint The sample to classify.
+ * @param budget The limits of the scan (zero fields are unlimited).
+ * @return The prediction, whether the scan completed and how many samples it compared.
  */
-double KNNClassifier::calculateDistance(const DataPoint &a, const DataPoint &b) const
+template <typename Row>
+AnytimePrediction KNNClassifier::classifyWithin(const Row &testPoint, const SearchBudget &budget) const
 {
-    // Ensure the feature vectors have the same size
-    if (a.features.size() != b.features.size())
+    constexpr size_t anytimeCheckInterval = 16;
+    auto deadline = std::chrono::steady_clock::now() + budget.time;
+
+    if (trainingData.empty())
+    {
+        throw std::runtime_error("KNNClassifier is not trained.");
+    }
+    if (referenceCount() == 0)
+    {
+        throw std::runtime_error("Every KNNClassifier reference sample was removed.");
+    }
+    if (testPoint.size() != trainingData.dimension())
     {
         throw std::invalid_argument("Feature vectors must have the same size.");
     }
 
-    // Calculate the Euclidean distance
-    double sum = 0.0;
-    for (size_t i = 0; i < a.features.size(); ++i)
+    thread_local NeighborHeap heap;
+    heap.reset(k);
+    const Scalar *query = contiguousRow(testPoint).values;
+    size_t dimension = trainingData.dimension();
+    size_t limit = budget.candidates > 0 ? budget.candidates : anytimeOrder.size();
+    bool timed = budget.time.count() > 0;
+
+    AnytimePrediction result;
+    size_t next = 0; // Position in anytimeOrder
+    for (; next < anytimeOrder.size() && result.scanned < limit; ++next)
     {
-        double diff = a.features[i] - b.features[i];
-        sum += diff * diff; // Sum of squared differences
+        size_t position = anytimeOrder[next];
+        if (removedCount > 0 && removed[position])
+        {
+            continue;
+        }
+        if (timed && result.scanned > 0 && result.scanned % anytimeCheckInterval == 0 &&
+            std::chrono::steady_clock::now() >= deadline)
+        {
+            break;
+        }
+        heap.push(distanceKernel(query, trainingData.data(position), dimension), position);
+        ++result.scanned;
     }
-    return std::sqrt(sum); // Return the square root of the sum (Euclidean distance)
+    // Trailing tombstones do not leave the scan incomplete
+    while (next < anytimeOrder.size() && removedCount > 0 && removed[anytimeOrder[next]])
+    {
+        ++next;
+    }
+    result.completed = next == anytimeOrder.size();
+    result.prediction = tally(heap.sort());
+    return result;
+}
+
+/**
+ * @brief Computes the weighted vote and the score of a set of neighbours.
+ *
+ * @param neighbors The k nearest neighbours, as (squared distance, position), nearest first.
+ * @return The label with the largest inverse-distance weighted vote (the smallest label wins
+ * a tie), its share of the vote and the negated sum of the distances.
+ */
+KNNPrediction KNNClassifier::tally(const std::vector<Neighbor> &neighbors) const
+{
+    KNNPrediction result;
+    double totalWeight = 0.0;
+    for (size_t i = 0; i < neighbors.size(); ++i)
+    {
+        double distance = std::sqrt(neighbors[i].first);
+        result.score -= distance;               // Sum of the distances, negated
+        totalWeight += 1.0 / (distance + 1e-6); // Avoid division by 0
+
+        // Weighted vote of this label, counted at its nearest occurrence only
+        int label = trainingData.label(neighbors[i].second);
+        bool counted = false;
+        for (size_t j = 0; j < i && !counted; ++j)
+        {
+            counted = trainingData.label(neighbors[j].second) == label;
+        }
+        if (counted)
+        {
+            continue;
+        }
+        double vote = 0.0;
+        for (size_t j = i; j < neighbors.size(); ++j)
+        {
+            if (trainingData.label(neighbors[j].second) == label)
+            {
+                vote += 1.0 / (std::sqrt(neighbors[j].first) + 1e-6);
+            }
+        }
+        if (i == 0 || vote > result.vote || (vote == result.vote && label < result.label))
+        {
+            result.label = label;
+            result.vote = vote;
+        }
+    }
+    if (totalWeight > 0)
+    {
+        result.vote /= totalWeight;
+    }
+    return result;
+}
+
+/**
+ * @brief Predicts the label for a given test data point.
+ *
+ * This function finds the nearest neighbors of the test point and returns the label with
+ * the largest inverse-distance weighted vote among them.
+ *
+ * @param testPoint The sample for which the label is to be predicted.
+ * @return The predicted label for the test point.
+ */
+template <typename Row>
+int KNNClassifier::predict(const Row &testPoint) const
+{
+    return classify(testPoint).label;
 }
 
 /**
  * @brief Predicts the label for a given test data point and returns the decision score.
  *
- * This function predicts the label similar to `predict`, but also calculates a score based on
- * the sum of the distances to the k nearest neighbors. The score is inversely related to the distance.
+ * This function predicts the label like `predict`, in the same neighbour search, and also
+ * returns a score based on the sum of the distances to the k nearest neighbors. The score is
+ * inversely related to the distance.
  *
- * @param testPoint The DataPoint for which the label and score are to be predicted.
+ * @param testPoint The sample for which the label and score are to be predicted.
  * @return A pair consisting of the predicted label and the decision score.
  */
-std::pair<int, double> KNNClassifier::predictWithScore(const DataPoint &testPoint) const
+template <typename Row>
+std::pair<int, double> KNNClassifier::predictWithScore(const Row &testPoint) const
+{
+    KNNPrediction prediction = classify(testPoint);
+    return {prediction.label, prediction.score}; // The score is negative to make smaller distances better
+}
+
+/**
+ * @brief Classifies a whole test set with blocked distance computations.
+ *
+ * Blocks of 64 queries are compared with blocks of 128 training samples at a time, through
+ * ||q||^2 + ||t||^2 - 2 q.t, so both blocks stay in cache while the dot-product kernel reuses
+ * every loaded value. The decomposition carries a rounding error of at most a few epsilons times
+ * ||q||^2 + ||t||^2, which could swap neighbours that are close in distance. Each query thus
+ * keeps, besides its k best decomposed distances, every candidate within twice that error
+ * bound of the k-th one; the candidates are rescored with squaredEuclidean() and ranked by
+ * (distance, position), so the predictions are the ones `classify` makes. Query blocks are
+ * processed in parallel.
+ *
+ * Approximate indexes are chosen on purpose, so their batches search the index for each
+ * query (in parallel) rather than falling back to the exact scan. Removed samples are skipped.
+ *
+ * @param testData The test samples, normalized like the training data.
+ * @return One prediction per test sample.
+ */
+std::vector<KNNPrediction> KNNClassifier::classifyBatch(const FeatureView &testData) const
 {
+    constexpr size_t queryBlock = 64;
+    constexpr size_t referenceBlock = 128;
+
     if (trainingData.empty())
     {
         throw std::runtime_error("KNNClassifier is not trained.");
     }
-
-    // Calculate the distance between the test point and each training point
-    std::vector<std::pair<double, int>> distances;
-    for (const auto &trainPoint : trainingData)
+    if (referenceCount() == 0)
     {
-        double distance = calculateDistance(testPoint, trainPoint);
-        distances.emplace_back(distance, trainPoint.label); // Store distance and label
+        throw std::runtime_error("Every KNNClassifier reference sample was removed.");
     }
-
-    // Sort the distances in ascending order
-    std::sort(distances.begin(), distances.end());
-
-    // Store the labels of the k nearest neighbors and calculate the sum of their distances
-    std::vector<int> neighborLabels;
-    double distanceSum = 0.0;
-    for (int i = 0; i < std::min(k, static_cast<int>(distances.size())); ++i)
+    if (testData.empty())
     {
-        neighborLabels.push_back(distances[i].second); // Store label of neighbor
-        distanceSum += distances[i].first;             // Sum of distances
+        return {};
+    }
+    if (testData.dimension() != trainingData.dimension())
+    {
+        throw std::invalid_argument("Feature vectors must have the same size.");
     }
 
-    // Count the frequency of each label among the neighbors
-    std::map<int, int> labelCounts;
-    for (int label : neighborLabels)
+    std::vector<KNNPrediction> results(testData.size());
+    if (isApproximate(activeIndex))
     {
-        labelCounts[label]++;
+        parallelFor(testData.size(), [&](size_t i)
+                    { results[i] = classify(testData.row(i)); });
+        return results;
     }
 
-    // Find the most frequent label among the neighbors
-    int predictedLabel = std::max_element(labelCounts.begin(), labelCounts.end(),
-                                          [](const auto &a, const auto &b)
-                                          { return a.second < b.second; })
-                             ->first;
+    std::vector<Accum> queryNorms = squaredNorms(testData);
+    Accum largestNorm = *std::max_element(trainingNorms.begin(), trainingNorms.end());
+    // Bound on |decomposed - squaredEuclidean| per unit of ||q||^2 + ||t||^2, padding included
+    Accum relativeError = 4 * static_cast<Accum>(trainingData.matrix().stride() + 2) * std::numeric_limits<Accum>::epsilon();
+    size_t blockCount = (testData.size() + queryBlock - 1) / queryBlock;
+    parallelFor(blockCount, [&](size_t block)
+                {
+                    size_t begin = block * queryBlock;
+                    size_t end = std::min(begin + queryBlock, testData.size());
+                    std::vector<Accum> distances(queryBlock * referenceBlock);
+                    std::vector<NeighborHeap> heaps(end - begin, NeighborHeap(k));
+                    std::vector<std::vector<Neighbor>> candidates(end - begin);
+                    std::vector<Accum> margins(end - begin);
+                    for (size_t q = 0; q < end - begin; ++q)
+                    {
+                        margins[q] = 2 * relativeError * (queryNorms[begin + q] + largestNorm);
+                    }
+
+                    for (size_t r = 0; r < trainingData.size(); r += referenceBlock)
+                    {
+                        size_t rEnd = std::min(r + referenceBlock, trainingData.size());
+                        squaredDistanceBlock(testData, begin, end, queryNorms.data(),
+                                             trainingData, r, rEnd, trainingNorms.data(),
+                                             distances.data(), referenceBlock);
+                        for (size_t q = 0; q < end - begin; ++q)
+                        {
+                            const Accum *row = &distances[q * referenceBlock];
+                            for (size_t j = 0; j < rEnd - r; ++j)
+                            {
+                                if (removedCount > 0 && removed[r + j])
+                                {
+                                    continue;
+                                }
+                                heaps[q].push(row[j], r + j);
+                                if (row[j] <= heaps[q].worst() + margins[q]) // The k-th distance only decreases
+                                {
+                                    candidates[q].emplace_back(row[j], r + j);
+                                }
+                            }
+                        }
+                    }
+
+                    // Exact distances of the candidates that may be among the k nearest
+                    std::vector<Neighbor> neighbors;
+                    for (size_t q = 0; q < end - begin; ++q)
+                    {
+                        FeatureRow query = testData.row(begin + q);
+                        Accum limit = heaps[q].worst() + margins[q];
+                        neighbors.clear();
+                        for (const auto &[distance, position] : candidates[q])
+                        {
+                            if (distance <= limit)
+                            {
+                                neighbors.emplace_back(squaredEuclidean(query, trainingData.data(position), trainingData.dimension()), position);
+                            }
+                        }
+                        std::sort(neighbors.begin(), neighbors.end());
+                        neighbors.resize(std::min(neighbors.size(), static_cast<size_t>(k)));
+                        results[begin + q] = tally(neighbors);
+                    } });
+    return results;
+}
 
-    // Return the predicted label and the inverse sum of the distances (as score)
-    return {predictedLabel, -distanceSum}; // The score is negative to make smaller distances better
+/**
+ * @brief Predicts the label and the decision score of every sample of a test set.
+ *
+ * @param testData The test samples, normalized like the training data.
+ * @return One (label, score) pair per test sample, as returned by `predictWithScore`.
+ */
+std::vector<std::pair<int, double>> KNNClassifier::predictBatch(const FeatureView &testData) const
+{
+    std::vector<std::pair<int, double>> predictions;
+    predictions.reserve(testData.size());
+    for (const KNNPrediction &prediction : classifyBatch(testData))
+    {
+        predictions.emplace_back(prediction.label, prediction.score);
+    }
+    return predictions;
 }
\ No newline at end of file
@@ -21,9 +21,9 @@ MLPClassifier::MLPClassifier(int inputSize, int hiddenSize, int outputSize)
     std::mt19937 gen(rd());
     std::uniform_real_distribution<> dis(-0.5, 0.5);
 
-    weightsInputHidden.resize(inputSize, std::vector<double>(hiddenSize));
+    weightsInputHidden.resize(inputSize, std::vector<Scalar>(hiddenSize));
     biasHidden.resize(hiddenSize);
-    weightsHiddenOutput.resize(hiddenSize, std::vector<double>(outputSize));
+    weightsHiddenOutput.resize(hiddenSize, std::vector<Scalar>(outputSize));
     biasOutput.resize(outputSize);
 
     // Random initialization of weights and biases
@@ -51,58 +51,15 @@ MLPClassifier::MLPClassifier(int inputSize, int hiddenSize, int outputSize)
     }
 }
 
-/**
- * @brief Normalize the features of a given dataset of DataPoints.
- *
- * For each DataPoint, computes the mean and standard deviation of its features,
- * and then normalizes each feature by subtracting the mean and dividing by the
- * standard deviation, effectively mapping the features to a Z-score scale.
- *
- * @param data The input dataset of DataPoints.
- * @return A new dataset of normalized DataPoints.
- */
-std::vector<DataPoint> MLPClassifier::normalizeData(const std::vector<DataPoint> &data) const
-{
-    std::vector<DataPoint> normalizedData = data;
-
-    for (auto &point : normalizedData)
-    {
-        double mean = 0.0;
-        double stddev = 0.0;
-
-        // Calculate mean
-        for (double value : point.features)
-        {
-            mean += value;
-        }
-        mean /= point.features.size();
-
-        // Calculate standard deviation
-        for (double value : point.features)
-        {
-            stddev += (value - mean) * (value - mean);
-        }
-        stddev = std::sqrt(stddev / point.features.size());
-
-        // Normalization
-        for (double &value : point.features)
-        {
-            value = (value - mean) / stddev; // Z-score normalization
-        }
-    }
-
-    return normalizedData;
-}
-
 /**
  * @brief The sigmoid function maps a real-valued number to a value between 0 and 1.
  *
  * @param x The input value.
  * @return The sigmoid of x, i.e. 1 / (1 + exp(-x)).
  */
-double MLPClassifier::sigmoid(double x) const
+Scalar MLPClassifier::sigmoid(Accum x) const
 {
-    return 1.0 / (1.0 + std::exp(-x));
+    return static_cast<Scalar>(1.0 / (1.0 + std::exp(-x)));
 }
 
 /**
@@ -111,36 +68,37 @@ double MLPClassifier::sigmoid(double x) const
  * Given a set of input features, computes the output of the network by
  * propagating the input through the hidden layer and the output layer.
  *
- * @param input The input features.
+ * @param input The input features (inputSize values, read through a pointer or a row accessor).
  * @return A std::pair containing the hidden layer output and the output layer
  *         output.
  */
-std::pair<std::vector<double>, std::vector<double>> MLPClassifier::forward(const std::vector<double> &input) const
+template <typename Input>
+std::pair<std::vector<Scalar>, std::vector<Scalar>> MLPClassifier::forward(const Input &input) const
 {
-    std::vector<double> hidden(hiddenSize);
+    std::vector<Scalar> hidden(hiddenSize);
     for (int j = 0; j < hiddenSize; ++j)
     {
-        hidden[j] = 0;
+        Accum sum = 0;
         for (int i = 0; i < inputSize; ++i)
         {
-            hidden[j] += input[i] * weightsInputHidden[i][j];
+            sum += input[i] * weightsInputHidden[i][j];
         }
-        hidden[j] += biasHidden[j];
-        hidden[j] = sigmoid(hidden[j]);
+        sum += biasHidden[j];
+        hidden[j] = sigmoid(sum);
     }
 
-    std::vector<double> logits(outputSize);
+    std::vector<Scalar> logits(outputSize);
     for (int k = 0; k < outputSize; ++k)
     {
-        logits[k] = 0.0;
+        Accum sum = 0.0;
         for (int j = 0; j < hiddenSize; ++j)
         {
-            logits[k] += hidden[j] * weightsHiddenOutput[j][k];
+            sum += hidden[j] * weightsHiddenOutput[j][k];
         }
-        logits[k] += biasOutput[k];
+        logits[k] = static_cast<Scalar>(sum + biasOutput[k]);
     }
 
-    std::vector<double> output = softmax(logits);
+    std::vector<Scalar> output = softmax(logits);
     return {hidden, output};
 }
 
@@ -155,13 +113,13 @@ std::pair<std::vector<double>, std::vector<double>> MLPClassifier::forward(const
  * @param logits The input vector of logits.
  * @return A vector of probabilities corresponding to the softmax of the logits.
  */
-std::vector<double> MLPClassifier::softmax(const std::vector<double> &logits) const
+std::vector<Scalar> MLPClassifier::softmax(const std::vector<Scalar> &logits) const
 {
-    std::vector<double> probabilities(logits.size());
-    double maxLogit = *std::max_element(logits.begin(), logits.end());
-    double sumExp = 0.0;
+    std::vector<Scalar> probabilities(logits.size());
+    Scalar maxLogit = *std::max_element(logits.begin(), logits.end());
+    Accum sumExp = 0.0;
 
-    for (double logit : logits)
+    for (Scalar logit : logits)
     {
         sumExp += std::exp(logit - maxLogit);
     }
@@ -187,35 +145,35 @@ std::vector<double> MLPClassifier::softmax(const std::vector<double> &logits) co
  * update the parameters. The model learns by minimizing the error
  * between the predicted and actual labels using gradient descent.
  *
- * @param trainingData A vector of DataPoints containing input features
+ * @param trainingData A selection of samples containing input features
  * and corresponding labels for training.
  * @param epochs The number of complete passes through the training dataset.
  * @param learningRate The step size for updating weights during training.
  */
-void MLPClassifier::train(const std::vector<DataPoint> &trainingData, int epochs, double learningRate)
+void MLPClassifier::train(const FeatureView &trainingData, int epochs, double learningRate)
 {
     for (int epoch = 0; epoch < epochs; ++epoch)
     {
-        for (const auto &data : trainingData)
+        for (const FeatureRow data : trainingData)
         {
-            int inputSize = data.features.size(); // Redefine the input size for each sample
+            int inputSize = data.size(); // Redefine the input size for each sample
 
             // Resize weights and biases according to the new input size
-            weightsInputHidden.resize(inputSize, std::vector<double>(hiddenSize));
+            weightsInputHidden.resize(inputSize, std::vector<Scalar>(hiddenSize));
             biasHidden.resize(hiddenSize);
 
             // Forward propagation
-            auto [hidden, output] = forward(data.features);
+            auto [hidden, output] = forward(data.values);
 
             // Calculate the error gradient for each class
-            std::vector<double> outputDeltas(outputSize);
+            std::vector<Scalar> outputDeltas(outputSize);
             for (int k = 0; k < outputSize; ++k)
             {
                 outputDeltas[k] = (data.label == k ? 1.0 : 0.0) - output[k]; // One-hot encoded target
                 outputDeltas[k] *= output[k] * (1.0 - output[k]);            // Apply sigmoid derivative
             }
 
-            std::vector<double> hiddenDeltas(hiddenSize, 0.0);
+            std::vector<Scalar> hiddenDeltas(hiddenSize, 0.0);
             for (int k = 0; k < outputSize; ++k)
             {
                 for (int j = 0; j < hiddenSize; ++j)
@@ -239,7 +197,7 @@ void MLPClassifier::train(const std::vector<DataPoint> &trainingData, int epochs
             {
                 for (int i = 0; i < inputSize; ++i)
                 {
-                    weightsInputHidden[i][j] += learningRate * hiddenDeltas[j] * data.features[i];
+                    weightsInputHidden[i][j] += learningRate * hiddenDeltas[j] * data[i];
                 }
                 biasHidden[j] += learningRate * hiddenDeltas[j];
             }
@@ -254,12 +212,13 @@ void MLPClassifier::train(const std::vector<DataPoint> &trainingData, int epochs
  * provided features of the data point, and returns the class label with the
  * highest predicted probability.
  *
- * @param point The DataPoint containing the input features.
+ * @param point The sample containing the input features.
  * @return The predicted class label as an integer.
  */
-int MLPClassifier::predict(const DataPoint &point) const
+template <typename Row>
+int MLPClassifier::predict(const Row &point) const
 {
-    auto [hidden, output] = forward(point.features);
+    auto [hidden, output] = forward(point);
     // Find the index of the class with the highest probability
     int predictedClass = std::distance(output.begin(), std::max_element(output.begin(), output.end()));
     return predictedClass;
@@ -272,12 +231,13 @@ int MLPClassifier::predict(const DataPoint &point) const
  * provided features of the data point, and returns the class label with the
  * highest predicted probability, along with the score for the most likely class.
  *
- * @param point The DataPoint containing the input features.
+ * @param point The sample containing the input features.
  * @return A std::pair containing the predicted class label as an integer, and the score of the most likely class as a double.
  */
-std::pair<int, double> MLPClassifier::predictWithScore(const DataPoint &point) const
+template <typename Row>
+std::pair<int, double> MLPClassifier::predictWithScore(const Row &point) const
 {
-    auto [hidden, output] = forward(point.features);
+    auto [hidden, output] = forward(point);
 
     // Find the index of the class with the highest probability
     int predictedClass = std::distance(output.begin(), std::max_element(output.begin(), output.end()));
@@ -0,0 +1,981 @@
+#include "../include/NeighborIndex.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <functional>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include "../include/DistanceKernels.h"
+#include "../include/Parallel.h"
+
+namespace
+{
+    // Feature with the largest range over some samples of a view, and that range
+    std::pair<size_t, Scalar> widestAxis(const FeatureView &data, const std::vector<size_t> &positions, size_t begin, size_t end)
+    {
+        size_t dimension = data.dimension();
+        std::vector<Scalar> low(data.data(positions[begin]), data.data(positions[begin]) + dimension);
+        std::vector<Scalar> high = low;
+        for (size_t i = begin + 1; i < end; ++i)
+        {
+            const Scalar *values = data.data(positions[i]);
+            for (size_t j = 0; j < dimension; ++j)
+            {
+                low[j] = std::min(low[j], values[j]);
+                high[j] = std::max(high[j], values[j]);
+            }
+        }
+
+        size_t axis = 0;
+        for (size_t j = 1; j < dimension; ++j)
+        {
+            if (high[j] - low[j] > high[axis] - low[axis])
+            {
+                axis = j;
+            }
+        }
+        return {axis, high[axis] - low[axis]};
+    }
+
+    // Reorders positions[begin, end) around its median on one feature and returns the median's slot
+    size_t partitionAtMedian(const FeatureView &data, std::vector<size_t> &positions, size_t begin, size_t end, size_t axis)
+    {
+        size_t middle = begin + (end - begin) / 2;
+        std::nth_element(positions.begin() + begin, positions.begin() + middle, positions.begin() + end,
+                         [&](size_t a, size_t b)
+                         { return data.data(a)[axis] < data.data(b)[axis]; });
+        return middle;
+    }
+
+    // Features added up between two comparisons of an early-abandon scan with the bound
+    constexpr size_t abandonBlock = 8;
+    static_assert((FeatureMatrix::alignment / sizeof(Scalar)) % abandonBlock == 0, "Row stride must be a multiple of the block");
+
+    // Copies the samples of a view in the order of positions
+    FeatureMatrix gatherPositions(const FeatureView &data, const std::vector<size_t> &positions)
+    {
+        FeatureMatrix points;
+        points.reserve(positions.size());
+        for (size_t position : positions)
+        {
+            points.append(data.row(position));
+        }
+        return points;
+    }
+}
+
+/**
+ * @brief Parses the name of a neighbour index, as given on the command line.
+ *
+ * @param name One of "brute", "kdtree", "balltree", "hnsw", "int8", "pq", "early", "ivf" or "auto".
+ * @return The index type.
+ */
+NeighborIndexType parseNeighborIndexType(const std::string &name)
+{
+    if (name == "brute")
+        return NeighborIndexType::BruteForce;
+    if (name == "kdtree")
+        return NeighborIndexType::KDTree;
+    if (name == "balltree")
+        return NeighborIndexType::BallTree;
+    if (name == "hnsw")
+        return NeighborIndexType::HNSW;
+    if (name == "int8")
+        return NeighborIndexType::Int8;
+    if (name == "pq")
+        return NeighborIndexType::ProductQuantized;
+    if (name == "early")
+        return NeighborIndexType::EarlyAbandon;
+    if (name == "ivf")
+        return NeighborIndexType::IVF;
+    if (name == "auto")
+        return NeighborIndexType::Auto;
+    throw std::invalid_argument("Unknown neighbour index: " + name);
+}
+
+/**
+ * @brief Returns a readable name for a neighbour index type.
+ *
+ * @param type The index type.
+ * @return Its name, for reports.
+ */
+std::string neighborIndexName(NeighborIndexType type)
+{
+    switch (type)
+    {
+    case NeighborIndexType::BruteForce:
+        return "brute force";
+    case NeighborIndexType::KDTree:
+        return "KD-tree";
+    case NeighborIndexType::BallTree:
+        return "ball tree";
+    case NeighborIndexType::HNSW:
+        return "HNSW graph";
+    case NeighborIndexType::Int8:
+        return "int8 store";
+    case NeighborIndexType::ProductQuantized:
+        return "product-quantized store";
+    case NeighborIndexType::EarlyAbandon:
+        return "early-abandon scan";
+    case NeighborIndexType::IVF:
+        return "IVF lists";
+    default:
+        return "auto";
+    }
+}
+
+/**
+ * @brief Tells whether an index may return other neighbours than an exact scan.
+ *
+ * @param type The index type.
+ * @return True for the graph, the compressed stores and the IVF lists.
+ */
+bool isApproximate(NeighborIndexType type)
+{
+    return type == NeighborIndexType::HNSW || type == NeighborIndexType::Int8 || type == NeighborIndexType::ProductQuantized ||
+           type == NeighborIndexType::IVF;
+}
+
+/**
+ * @brief Computes the squared Euclidean distance between a query and a stored sample.
+ *
+ * The distance comes from the dispatched squaredL2 kernel. Searches should pass a FeatureRow:
+ * any other accessor is copied into a contiguous buffer at every call.
+ *
+ * @param a The query.
+ * @param b The stored sample.
+ * @param dimension The number of features.
+ * @return The sum of the squared differences.
+ */
+template <typename Row>
+Accum squaredEuclidean(const Row &a, const Scalar *b, size_t dimension)
+{
+    return squaredL2(contiguousRow(a).values, b, dimension);
+}
+
+/**
+ * @brief Empties the heap for a new search.
+ *
+ * @param count The number of neighbours to keep.
+ */
+void NeighborHeap::reset(size_t count)
+{
+    k = count;
+    heap.clear();
+    heap.reserve(k);
+}
+
+/**
+ * @brief Returns the distance a candidate has to beat to enter the heap.
+ *
+ * @return The largest kept distance once k candidates are kept, infinity before.
+ */
+Accum NeighborHeap::worst() const
+{
+    return full() && !heap.empty() ? heap.front().first : std::numeric_limits<Accum>::infinity();
+}
+
+/**
+ * @brief Offers a candidate to the heap.
+ *
+ * @param squaredDistance The squared distance of the candidate to the query.
+ * @param position The candidate's position in the indexed view.
+ */
+void NeighborHeap::push(Accum squaredDistance, size_t position)
+{
+    Neighbor candidate(squaredDistance, position);
+    if (!full())
+    {
+        heap.push_back(candidate);
+        std::push_heap(heap.begin(), heap.end());
+    }
+    else if (k > 0 && candidate < heap.front())
+    {
+        std::pop_heap(heap.begin(), heap.end());
+        heap.back() = candidate;
+        std::push_heap(heap.begin(), heap.end());
+    }
+}
+
+/**
+ * @brief Sorts the kept neighbours in place.
+ *
+ * @return The neighbours ordered by (distance, position).
+ */
+const std::vector<Neighbor> &NeighborHeap::sort()
+{
+    std::sort_heap(heap.begin(), heap.end());
+    return heap;
+}
+
+/**
+ * @brief Builds the tree over the samples of a view.
+ *
+ * The samples are copied in leaf order, so a leaf scan reads contiguous memory.
+ *
+ * @param data The indexed samples (their positions are returned by the searches).
+ * @param leafSize The largest number of samples of a leaf.
+ */
+void KDTree::build(const FeatureView &data, size_t leafSize)
+{
+    nodes.clear();
+    positions.resize(data.size());
+    std::iota(positions.begin(), positions.end(), 0);
+    if (!data.empty())
+    {
+        buildNode(data, 0, data.size(), std::max<size_t>(leafSize, 1));
+    }
+    points = gatherPositions(data, positions);
+}
+
+/**
+ * @brief Builds the subtree holding some samples.
+ *
+ * @param data The indexed samples.
+ * @param begin First slot of positions covered by the node.
+ * @param end Slot past the last one covered by the node.
+ * @param leafSize The largest number of samples of a leaf.
+ * @return The index of the node.
+ */
+int KDTree::buildNode(const FeatureView &data, size_t begin, size_t end, size_t leafSize)
+{
+    int index = static_cast<int>(nodes.size());
+    nodes.push_back(Node{begin, end});
+    if (end - begin <= leafSize)
+    {
+        return index;
+    }
+
+    auto [axis, spread] = widestAxis(data, positions, begin, end);
+    if (spread <= 0)
+    {
+        return index; // All samples are equal: keep them in one leaf
+    }
+    size_t middle = partitionAtMedian(data, positions, begin, end, axis);
+
+    Scalar split = data.data(positions[middle])[axis];
+    int left = buildNode(data, begin, middle, leafSize);
+    int right = buildNode(data, middle, end, leafSize);
+    nodes[index].axis = axis;
+    nodes[index].split = split;
+    nodes[index].left = left;
+    nodes[index].right = right;
+    return index;
+}
+
+/**
+ * @brief Finds the nearest indexed samples of a query.
+ *
+ * @param query The query sample.
+ * @param heap Receives the candidates; its size sets the number of neighbours.
+ */
+template <typename Row>
+void KDTree::search(const Row &query, NeighborHeap &heap) const
+{
+    if (!nodes.empty())
+    {
+        searchNode(0, query, heap);
+    }
+}
+
+/**
+ * @brief Searches a subtree, nearest child first.
+ *
+ * The far child is skipped when the distance from the query to the splitting plane already
+ * exceeds the k-th best distance. Equal distances are still visited, so ties resolve like in
+ * a full scan.
+ *
+ * @param node The subtree.
+ * @param query The query sample.
+ * @param heap The best candidates so far.
+ */
+template <typename Row>
+void KDTree::searchNode(int node, const Row &query, NeighborHeap &heap) const
+{
+    const Node &current = nodes[node];
+    if (current.left < 0)
+    {
+        for (size_t i = current.begin; i < current.end; ++i)
+        {
+            heap.push(squaredEuclidean(query, points.data(i), points.dimension()), positions[i]);
+        }
+        return;
+    }
+
+    Accum diff = query[current.axis] - current.split; // Same rounding as squaredEuclidean
+    int nearChild = diff < 0 ? current.left : current.right;
+    int farChild = diff < 0 ? current.right : current.left;
+    searchNode(nearChild, query, heap);
+    if (diff * diff <= heap.worst())
+    {
+        searchNode(farChild, query, heap);
+    }
+}
+
+/**
+ * @brief Builds the tree over the samples of a view.
+ *
+ * @param data The indexed samples (their positions are returned by the searches).
+ * @param leafSize The largest number of samples of a leaf.
+ */
+void BallTree::build(const FeatureView &data, size_t leafSize)
+{
+    nodes.clear();
+    centers = FeatureMatrix();
+    positions.resize(data.size());
+    std::iota(positions.begin(), positions.end(), 0);
+    if (!data.empty())
+    {
+        buildNode(data, 0, data.size(), std::max<size_t>(leafSize, 1));
+    }
+    points = gatherPositions(data, positions);
+}
+
+/**
+ * @brief Builds the subtree holding some samples.
+ *
+ * The ball is centred on the mean of the samples; its radius is the largest distance from
+ * that centre. Internal nodes split at the median of the feature with the largest spread.
+ *
+ * @param data The indexed samples.
+ * @param begin First slot of positions covered by the node.
+ * @param end Slot past the last one covered by the node.
+ * @param leafSize The largest number of samples of a leaf.
+ * @return The index of the node.
+ */
+int BallTree::buildNode(const FeatureView &data, size_t begin, size_t end, size_t leafSize)
+{
+    size_t dimension = data.dimension();
+    std::vector<Accum> mean(dimension, 0.0);
+    for (size_t i = begin; i < end; ++i)
+    {
+        const Scalar *values = data.data(positions[i]);
+        for (size_t j = 0; j < dimension; ++j)
+        {
+            mean[j] += values[j];
+        }
+    }
+    DataPoint center;
+    center.features.resize(dimension);
+    for (size_t j = 0; j < dimension; ++j)
+    {
+        center.features[j] = mean[j] / (end - begin);
+    }
+    centers.append(center);
+    const Scalar *centerValues = centers.data(centers.size() - 1);
+
+    Accum radius = 0;
+    for (size_t i = begin; i < end; ++i)
+    {
+        radius = std::max(radius, squaredEuclidean(data.row(positions[i]), centerValues, dimension));
+    }
+
+    int index = static_cast<int>(nodes.size());
+    nodes.push_back(Node{begin, end, -1, -1, std::sqrt(radius)});
+    if (end - begin <= leafSize)
+    {
+        return index;
+    }
+
+    auto [axis, spread] = widestAxis(data, positions, begin, end);
+    if (spread <= 0)
+    {
+        return index; // All samples are equal: keep them in one leaf
+    }
+    size_t middle = partitionAtMedian(data, positions, begin, end, axis);
+
+    int left = buildNode(data, begin, middle, leafSize);
+    int right = buildNode(data, middle, end, leafSize);
+    nodes[index].left = left;
+    nodes[index].right = right;
+    return index;
+}
+
+/**
+ * @brief Finds the nearest indexed samples of a query.
+ *
+ * @param query The query sample.
+ * @param heap Receives the candidates; its size sets the number of neighbours.
+ */
+template <typename Row>
+void BallTree::search(const Row &query, NeighborHeap &heap) const
+{
+    if (!nodes.empty())
+    {
+        searchNode(0, query, heap);
+    }
+}
+
+/**
+ * @brief Bounds the distance from a query to any sample of a ball.
+ *
+ * The triangle inequality gives distance(query, centre) - radius. The bound is lowered by a
+ * few rounding errors of the terms, so it never exceeds a distance computed by
+ * squaredEuclidean and the pruning stays exact.
+ *
+ * @param node The ball.
+ * @param query The query sample.
+ * @return A lower bound of the Euclidean distance (not squared), possibly negative.
+ */
+template <typename Row>
+Accum BallTree::lowerBound(int node, const Row &query) const
+{
+    constexpr Accum tolerance = 1024 * std::numeric_limits<Accum>::epsilon();
+    Accum centerDistance = std::sqrt(squaredEuclidean(query, centers.data(node), centers.dimension()));
+    Accum radius = nodes[node].radius;
+    return centerDistance - radius - tolerance * (centerDistance + radius);
+}
+
+/**
+ * @brief Searches a subtree, nearest ball first, skipping balls that cannot hold a sample
+ * closer than the k-th best distance.
+ *
+ * @param node The subtree.
+ * @param query The query sample.
+ * @param heap The best candidates so far.
+ */
+template <typename Row>
+void BallTree::searchNode(int node, const Row &query, NeighborHeap &heap) const
+{
+    const Node &current = nodes[node];
+    if (current.left < 0)
+    {
+        for (size_t i = current.begin; i < current.end; ++i)
+        {
+            heap.push(squaredEuclidean(query, points.data(i), points.dimension()), positions[i]);
+        }
+        return;
+    }
+
+    Accum leftBound = lowerBound(current.left, query);
+    Accum rightBound = lowerBound(current.right, query);
+    int children[2] = {current.left, current.right};
+    Accum bounds[2] = {leftBound, rightBound};
+    if (rightBound < leftBound)
+    {
+        std::swap(children[0], children[1]);
+        std::swap(bounds[0], bounds[1]);
+    }
+    for (int c = 0; c < 2; ++c)
+    {
+        if (bounds[c] <= 0 || bounds[c] * bounds[c] <= heap.worst())
+        {
+            searchNode(children[c], query, heap);
+        }
+    }
+}
+
+/**
+ * @brief Builds the graph over the samples of a view.
+ *
+ * Each node draws its top layer from an exponential distribution (seeded, so the layers are
+ * reproducible); the first node is the entry point and the others are inserted in parallel.
+ * Per-node locks protect the link lists while the graph grows.
+ *
+ * @param data The indexed samples (their positions are returned by the searches).
+ * @param parameters The graph settings.
+ */
+void HNSWIndex::build(const FeatureView &data, const HNSWParameters &parameters)
+{
+    settings = parameters;
+    settings.M = std::max<size_t>(settings.M, 2);
+    settings.efConstruction = std::max(settings.efConstruction, settings.M);
+    points = data.materialize();
+
+    size_t count = points.size();
+    levelGenerator.seed(2024);
+    levels.resize(count);
+    upperLinks.assign(count, {});
+    for (size_t i = 0; i < count; ++i)
+    {
+        levels[i] = drawLevel();
+        upperLinks[i].resize(levels[i]);
+    }
+    baseLinks.assign(count * maxLinks(0), 0);
+    baseLinkCount.assign(count, 0);
+    if (count == 0)
+    {
+        maxLevel = -1;
+        return;
+    }
+
+    entryPoint = 0;
+    maxLevel = levels[0];
+    std::vector<std::mutex> locks(count);
+    std::mutex entryLock;
+    parallelFor(count - 1, [&](size_t i)
+                { insert(static_cast<uint32_t>(i + 1), &locks, &entryLock); });
+}
+
+/**
+ * @brief Draws the top layer of a new node.
+ *
+ * @return A level from the exponential distribution of HNSW, of scale 1 / ln(M).
+ */
+int HNSWIndex::drawLevel()
+{
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    double levelScale = 1.0 / std::log(static_cast<double>(settings.M));
+    return static_cast<int>(-std::log(1.0 - uniform(levelGenerator)) * levelScale);
+}
+
+/**
+ * @brief Inserts one sample into a built graph.
+ *
+ * The sample becomes the next node (and position); it is linked like the nodes of build(),
+ * so the graph does not need rebuilding. A graph built over no sample starts from this one.
+ *
+ * @param sample The sample to insert.
+ */
+void HNSWIndex::add(const FeatureRow &sample)
+{
+    uint32_t node = static_cast<uint32_t>(points.size());
+    points.append(sample);
+    levels.push_back(drawLevel());
+    upperLinks.emplace_back(levels.back());
+    baseLinks.resize(baseLinks.size() + maxLinks(0), 0);
+    baseLinkCount.push_back(0);
+    if (node == 0)
+    {
+        entryPoint = 0;
+        maxLevel = levels[0];
+        return;
+    }
+    insert(node, nullptr, nullptr);
+}
+
+/**
+ * @brief Links a node into the graph.
+ *
+ * Above the node's top layer the search only descends greedily; on its layers it collects
+ * efConstruction candidates, links the node to a diverse subset of them, and adds the
+ * reverse links, pruning the neighbours that exceed their link budget.
+ *
+ * @param node The node to insert.
+ * @param locks One lock per node, guarding its link lists (null: no concurrent insertion).
+ * @param entryLock Guards the entry point; held for the whole insertion of a node that becomes
+ *                  the new top of the graph (null: no concurrent insertion).
+ */
+void HNSWIndex::insert(uint32_t node, std::vector<std::mutex> *locks, std::mutex *entryLock)
+{
+    int level = levels[node];
+    std::unique_lock<std::mutex> entryGuard;
+    if (entryLock)
+    {
+        entryGuard = std::unique_lock<std::mutex>(*entryLock);
+    }
+    int topLevel = maxLevel;
+    uint32_t current = entryPoint;
+    if (level <= topLevel && entryGuard.owns_lock())
+    {
+        entryGuard.unlock();
+    }
+
+    FeatureRow query = points.row(node);
+    for (int layer = topLevel; layer > level; --layer)
+    {
+        current = greedyClosest(query, current, layer, locks);
+    }
+
+    std::vector<Candidate> nearest;
+    std::vector<uint32_t> links;
+    for (int layer = std::min(level, topLevel); layer >= 0; --layer)
+    {
+        searchLayer(query, current, settings.efConstruction, layer, nearest, locks);
+        current = nearest.front().second;
+        nearest.erase(std::remove_if(nearest.begin(), nearest.end(), [node](const Candidate &candidate)
+                                     { return candidate.second == node; }),
+                      nearest.end());
+        selectNeighbors(nearest, settings.M);
+        {
+            std::unique_lock<std::mutex> guard;
+            if (locks)
+            {
+                guard = std::unique_lock<std::mutex>((*locks)[node]);
+            }
+            setLinks(node, layer, nearest);
+        }
+
+        // Reverse links
+        for (const Candidate &neighbor : nearest)
+        {
+            uint32_t other = neighbor.second;
+            std::unique_lock<std::mutex> guard;
+            if (locks)
+            {
+                guard = std::unique_lock<std::mutex>((*locks)[other]);
+            }
+            copyLinks(other, layer, links, nullptr);
+            std::vector<Candidate> candidates;
+            candidates.reserve(links.size() + 1);
+            for (uint32_t link : links)
+            {
+                candidates.emplace_back(squaredEuclidean(points.row(other), points.data(link), points.dimension()), link);
+            }
+            candidates.emplace_back(neighbor.first, node);
+            if (candidates.size() > maxLinks(layer))
+            {
+                std::sort(candidates.begin(), candidates.end());
+                selectNeighbors(candidates, maxLinks(layer));
+            }
+            setLinks(other, layer, candidates);
+        }
+    }
+
+    if (level > topLevel)
+    {
+        entryPoint = node;
+        maxLevel = level;
+    }
+}
+
+/**
+ * @brief Keeps a diverse subset of candidates, as in the neighbour-selection heuristic of HNSW.
+ *
+ * A candidate is kept only if it is closer to the base node than to every candidate already
+ * kept, so the links spread in different directions instead of clustering.
+ *
+ * @param candidates The candidates, as (squared distance to the base node, node), nearest
+ *                   first. Replaced by the kept ones.
+ * @param count The largest number of candidates to keep.
+ */
+void HNSWIndex::selectNeighbors(std::vector<Candidate> &candidates, size_t count) const
+{
+    std::vector<Candidate> selected;
+    for (const Candidate &candidate : candidates)
+    {
+        if (selected.size() >= count)
+        {
+            break;
+        }
+        bool diverse = true;
+        for (const Candidate &kept : selected)
+        {
+            Accum distance = squaredEuclidean(points.row(candidate.second), points.data(kept.second), points.dimension());
+            if (distance < candidate.first)
+            {
+                diverse = false;
+                break;
+            }
+        }
+        if (diverse)
+        {
+            selected.push_back(candidate);
+        }
+    }
+    candidates.swap(selected);
+}
+
+/**
+ * @brief Copies the links of a node on a layer.
+ *
+ * @param node The node.
+ * @param layer The layer (at most the node's top layer).
+ * @param out Receives the linked nodes.
+ * @param locks If not null, the node's lock is held during the copy.
+ */
+void HNSWIndex::copyLinks(uint32_t node, int layer, std::vector<uint32_t> &out, std::vector<std::mutex> *locks) const
+{
+    std::unique_lock<std::mutex> guard;
+    if (locks)
+    {
+        guard = std::unique_lock<std::mutex>((*locks)[node]);
+    }
+    if (layer == 0)
+    {
+        const uint32_t *first = &baseLinks[node * maxLinks(0)];
+        out.assign(first, first + baseLinkCount[node]);
+    }
+    else
+    {
+        out = upperLinks[node][layer - 1];
+    }
+}
+
+/**
+ * @brief Replaces the links of a node on a layer (the caller holds the node's lock).
+ *
+ * @param node The node.
+ * @param layer The layer (at most the node's top layer).
+ * @param selected The new neighbours, at most maxLinks(layer) of them.
+ */
+void HNSWIndex::setLinks(uint32_t node, int layer, const std::vector<Candidate> &selected)
+{
+    if (layer == 0)
+    {
+        uint32_t *first = &baseLinks[node * maxLinks(0)];
+        for (size_t i = 0; i < selected.size(); ++i)
+        {
+            first[i] = selected[i].second;
+        }
+        baseLinkCount[node] = static_cast<uint32_t>(selected.size());
+    }
+    else
+    {
+        std::vector<uint32_t> &links = upperLinks[node][layer - 1];
+        links.clear();
+        for (const Candidate &candidate : selected)
+        {
+            links.push_back(candidate.second);
+        }
+    }
+}
+
+/**
+ * @brief Walks a layer from node to node, always moving to the neighbour closest to the query.
+ *
+ * @param query The query sample.
+ * @param entry The starting node.
+ * @param layer The layer walked.
+ * @param locks If not null (while building), the node locks.
+ * @return The node where no neighbour is closer (a local minimum).
+ */
+template <typename Row>
+uint32_t HNSWIndex::greedyClosest(const Row &query, uint32_t entry, int layer, std::vector<std::mutex> *locks) const
+{
+    thread_local std::vector<uint32_t> links;
+    Candidate best(squaredEuclidean(query, points.data(entry), points.dimension()), entry);
+    bool moved = true;
+    while (moved)
+    {
+        moved = false;
+        copyLinks(best.second, layer, links, locks);
+        for (uint32_t link : links)
+        {
+            Candidate candidate(squaredEuclidean(query, points.data(link), points.dimension()), link);
+            if (candidate < best)
+            {
+                best = candidate;
+                moved = true;
+            }
+        }
+    }
+    return best.second;
+}
+
+/**
+ * @brief Best-first search of one layer, keeping the ef closest nodes seen.
+ *
+ * The search stops when the closest unexplored node is farther than the ef-th best result.
+ * Visited nodes are marked with a per-thread generation counter, so nothing is cleared
+ * between searches.
+ *
+ * @param query The query sample.
+ * @param entry The starting node.
+ * @param ef The number of results kept.
+ * @param layer The layer searched.
+ * @param nearest Receives the results, nearest first.
+ * @param locks If not null (while building), the node locks.
+ */
+template <typename Row>
+void HNSWIndex::searchLayer(const Row &query, uint32_t entry, size_t ef, int layer,
+                            std::vector<Candidate> &nearest, std::vector<std::mutex> *locks) const
+{
+    thread_local std::vector<unsigned> visitMarks;
+    thread_local unsigned visitGeneration = 0;
+    thread_local std::vector<Candidate> frontier; // Min-heap of nodes to explore
+    thread_local std::vector<uint32_t> links;
+
+    if (visitMarks.size() < levels.size())
+    {
+        visitMarks.resize(levels.size(), 0);
+    }
+    if (++visitGeneration == 0) // Wrapped around: clear the marks once
+    {
+        std::fill(visitMarks.begin(), visitMarks.end(), 0);
+        visitGeneration = 1;
+    }
+
+    auto farther = std::greater<Candidate>();
+    Candidate start(squaredEuclidean(query, points.data(entry), points.dimension()), entry);
+    visitMarks[entry] = visitGeneration;
+    frontier.assign(1, start);
+    nearest.assign(1, start); // Max-heap of the results
+
+    while (!frontier.empty())
+    {
+        std::pop_heap(frontier.begin(), frontier.end(), farther);
+        Candidate closest = frontier.back();
+        frontier.pop_back();
+        if (nearest.size() >= ef && closest.first > nearest.front().first)
+        {
+            break;
+        }
+
+        copyLinks(closest.second, layer, links, locks);
+        for (uint32_t link : links)
+        {
+            if (visitMarks[link] == visitGeneration)
+            {
+                continue;
+            }
+            visitMarks[link] = visitGeneration;
+
+            Candidate candidate(squaredEuclidean(query, points.data(link), points.dimension()), link);
+            if (nearest.size() < ef || candidate < nearest.front())
+            {
+                frontier.push_back(candidate);
+                std::push_heap(frontier.begin(), frontier.end(), farther);
+                nearest.push_back(candidate);
+                std::push_heap(nearest.begin(), nearest.end());
+                if (nearest.size() > ef)
+                {
+                    std::pop_heap(nearest.begin(), nearest.end());
+                    nearest.pop_back();
+                }
+            }
+        }
+    }
+    std::sort_heap(nearest.begin(), nearest.end());
+}
+
+/**
+ * @brief Finds approximate nearest neighbours of a query.
+ *
+ * Descends greedily from the entry point to the bottom layer, then searches it with
+ * max(efSearch, k) candidates and offers them to the heap.
+ *
+ * @param query The query sample.
+ * @param heap Receives the candidates; its size sets the number of neighbours.
+ */
+template <typename Row>
+void HNSWIndex::search(const Row &query, NeighborHeap &heap) const
+{
+    if (empty())
+    {
+        return;
+    }
+
+    uint32_t current = entryPoint;
+    for (int layer = maxLevel; layer > 0; --layer)
+    {
+        current = greedyClosest(query, current, layer, nullptr);
+    }
+
+    thread_local std::vector<Candidate> nearest;
+    searchLayer(query, current, std::max(settings.efSearch, heap.capacity()), 0, nearest, nullptr);
+    for (const Candidate &candidate : nearest)
+    {
+        heap.push(candidate.first, candidate.second);
+    }
+}
+
+/**
+ * @brief Copies the samples of a view for the early-abandon scan.
+ *
+ * @param data The indexed samples (their positions are returned by the searches).
+ * @param orderByVariance Whether the features are scanned by decreasing variance over the
+ *                        samples (otherwise in their natural order; ties keep that order).
+ */
+void EarlyAbandonScan::build(const FeatureView &data, bool orderByVariance)
+{
+    reference = data;
+    size_t dimension = data.dimension();
+    exactKernel = squaredL2Kernel(dimension);
+    featureOrder.resize(dimension);
+    std::iota(featureOrder.begin(), featureOrder.end(), 0);
+    points = FeatureMatrix(data.size(), dimension);
+    if (data.empty())
+    {
+        return;
+    }
+
+    if (orderByVariance)
+    {
+        std::vector<Accum> means(dimension, 0.0), variances(dimension, 0.0);
+        for (size_t i = 0; i < data.size(); ++i)
+        {
+            const Scalar *values = data.data(i);
+            for (size_t j = 0; j < dimension; ++j)
+            {
+                means[j] += values[j];
+            }
+        }
+        for (size_t i = 0; i < data.size(); ++i)
+        {
+            const Scalar *values = data.data(i);
+            for (size_t j = 0; j < dimension; ++j)
+            {
+                Accum diff = values[j] - means[j] / data.size();
+                variances[j] += diff * diff;
+            }
+        }
+        // Variances are compared in 1/1024ths of the largest one: standardized features, whose
+        // variances only differ by rounding, keep their natural order
+        Accum largest = *std::max_element(variances.begin(), variances.end());
+        std::vector<long> rank(dimension, 0);
+        for (size_t j = 0; j < dimension && largest > 0; ++j)
+        {
+            rank[j] = std::lround(variances[j] / largest * 1024);
+        }
+        std::stable_sort(featureOrder.begin(), featureOrder.end(), [&](uint32_t a, uint32_t b)
+                         { return rank[a] > rank[b]; });
+    }
+
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        const Scalar *values = data.data(i);
+        Scalar *ordered = points.data(i);
+        for (size_t j = 0; j < dimension; ++j)
+        {
+            ordered[j] = values[featureOrder[j]];
+        }
+        points.setLabel(i, data.label(i));
+    }
+}
+
+/**
+ * @brief Finds the exact nearest neighbours of a query, abandoning distant samples early.
+ *
+ * The partial sums run in the scan order of the features, with another rounding than the
+ * squaredL2 kernel: a sample is only abandoned once its partial sum exceeds the bound by more
+ * than that rounding can explain, and the samples that reach the end are pushed with their
+ * kernel distance. The rows and the reordered query are zero-padded to the row stride, so the
+ * blocks of abandonBlock features have no remainder.
+ *
+ * @param query The query sample.
+ * @param heap Receives the neighbours; its size sets their number.
+ */
+template <typename Row>
+void EarlyAbandonScan::search(const Row &query, NeighborHeap &heap) const
+{
+    thread_local std::vector<Scalar> orderedQuery;
+
+    FeatureRow values = contiguousRow(query);
+    size_t dimension = points.dimension();
+    size_t stride = points.stride();
+    orderedQuery.assign(stride, 0);
+    for (size_t j = 0; j < dimension; ++j)
+    {
+        orderedQuery[j] = values[featureOrder[j]];
+    }
+
+    // Both sums have a relative error below dimension * epsilon (their terms are non-negative)
+    const Accum slack = 1 + 4 * dimension * std::numeric_limits<Accum>::epsilon();
+    Accum bound = heap.worst() * slack;
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+        const Scalar *sample = points.data(i);
+        Accum sums[abandonBlock] = {};
+        Accum partial = 0.0;
+        for (size_t j = 0; j < stride && partial <= bound; j += abandonBlock)
+        {
+            for (size_t l = 0; l < abandonBlock; ++l)
+            {
+                Accum diff = orderedQuery[j + l] - sample[j + l];
+                sums[l] += diff * diff;
+            }
+            partial = 0.0;
+            for (size_t l = 0; l < abandonBlock; ++l)
+            {
+                partial += sums[l];
+            }
+        }
+        if (partial <= bound)
+        {
+            heap.push(exactKernel(values.values, reference.data(i), dimension), i);
+            bound = heap.worst() * slack;
+        }
+    }
+}
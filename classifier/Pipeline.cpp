@@ -0,0 +1,80 @@
+#include "../include/Pipeline.h"
+#include <algorithm>
+
+/**
+ * @brief Fits the scaler on the training data, then trains the classifier on it.
+ *
+ * The training samples are normalized once, into a matrix owned by the pipeline, since the
+ * classifier reads them many times (and KNN keeps them for its predictions).
+ *
+ * @param data The raw training data.
+ * @param args Extra arguments for the classifier's train().
+ */
+template <typename Scaler, typename Classifier>
+template <typename... Args>
+void Pipeline<Scaler, Classifier>::train(const FeatureView &data, Args &&...args)
+{
+    fittedScaler.fit(data);
+    trainingData = data.materialize();
+    fittedScaler.transform(trainingData);
+    model.train(FeatureView(trainingData), std::forward<Args>(args)...);
+}
+
+/**
+ * @brief Predicts the label of a raw sample.
+ *
+ * The sample is handed to the classifier through the scaler's bound row, so every feature
+ * is normalized when the classifier reads it.
+ *
+ * @param point The raw sample.
+ * @return The predicted label.
+ */
+template <typename Scaler, typename Classifier>
+int Pipeline<Scaler, Classifier>::predict(const FeatureRow &point) const
+{
+    return model.predict(fittedScaler.bind(point));
+}
+
+/**
+ * @brief Predicts the label of a raw sample and returns the classifier's decision score.
+ *
+ * @param point The raw sample.
+ * @return A pair consisting of the predicted label and the decision score.
+ */
+template <typename Scaler, typename Classifier>
+std::pair<int, double> Pipeline<Scaler, Classifier>::predictWithScore(const FeatureRow &point) const
+{
+    return model.predictWithScore(fittedScaler.bind(point));
+}
+
+/**
+ * @brief Predicts the labels and scores of a whole raw test set in one batch call per block.
+ *
+ * Batch kernels need the normalized samples in memory, so the test set is normalized by
+ * blocks of batchBlockSize samples: the copy stays small whatever the size of the test set.
+ *
+ * @param samples The raw test samples.
+ * @return The classifier's predictions, one per sample.
+ */
+template <typename Scaler, typename Classifier>
+template <typename Model>
+auto Pipeline<Scaler, Classifier>::predictBatch(const FeatureView &samples) const
+    -> decltype(std::declval<const Model &>().predictBatch(samples))
+{
+    decltype(std::declval<const Model &>().predictBatch(samples)) predictions;
+    predictions.reserve(samples.size());
+    for (size_t begin = 0; begin < samples.size(); begin += batchBlockSize)
+    {
+        std::vector<size_t> positions;
+        for (size_t i = begin; i < std::min(begin + batchBlockSize, samples.size()); ++i)
+        {
+            positions.push_back(i);
+        }
+        FeatureMatrix block = samples.subset(positions).materialize();
+        fittedScaler.transform(block);
+
+        auto blockPredictions = model.predictBatch(FeatureView(block));
+        predictions.insert(predictions.end(), blockPredictions.begin(), blockPredictions.end());
+    }
+    return predictions;
+}
@@ -0,0 +1,193 @@
+#include "../include/PrototypeSelection.h"
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <set>
+#include <stdexcept>
+#include "../include/DistanceKernels.h"
+#include "../include/NeighborIndex.h"
+#include "../include/Parallel.h"
+
+/**
+ * @brief Parses the name of a prototype selection, as given on the command line.
+ *
+ * @param name One of "none", "enn", "cnn" or "enn+cnn".
+ * @return The selection.
+ */
+PrototypeSelection parsePrototypeSelection(const std::string &name)
+{
+    if (name == "none")
+        return PrototypeSelection::None;
+    if (name == "enn")
+        return PrototypeSelection::Edited;
+    if (name == "cnn")
+        return PrototypeSelection::Condensed;
+    if (name == "enn+cnn")
+        return PrototypeSelection::EditedCondensed;
+    throw std::invalid_argument("Unknown prototype selection: " + name);
+}
+
+/**
+ * @brief Returns a readable name for a prototype selection.
+ *
+ * @param selection The selection.
+ * @return Its name, for reports.
+ */
+std::string prototypeSelectionName(PrototypeSelection selection)
+{
+    switch (selection)
+    {
+    case PrototypeSelection::Edited:
+        return "edited NN";
+    case PrototypeSelection::Condensed:
+        return "condensed NN";
+    case PrototypeSelection::EditedCondensed:
+        return "edited + condensed NN";
+    default:
+        return "none";
+    }
+}
+
+/**
+ * @brief Selects the prototypes of a reference set.
+ *
+ * @param data The training samples.
+ * @param selection The reduction to apply.
+ * @param k The neighbourhood of the editing step.
+ * @return The positions kept, in increasing order.
+ */
+std::vector<size_t> selectPrototypes(const FeatureView &data, PrototypeSelection selection, int k)
+{
+    std::vector<size_t> kept(data.size());
+    std::iota(kept.begin(), kept.end(), 0);
+    if (selection == PrototypeSelection::Edited || selection == PrototypeSelection::EditedCondensed)
+    {
+        kept = editedNearestNeighbours(data, k);
+    }
+    if (selection == PrototypeSelection::Condensed || selection == PrototypeSelection::EditedCondensed)
+    {
+        std::vector<size_t> condensed = condensedNearestNeighbours(data.subset(kept));
+        for (size_t &position : condensed)
+        {
+            position = kept[position];
+        }
+        kept = std::move(condensed);
+    }
+    return kept;
+}
+
+/**
+ * @brief Wilson's editing: removes the samples that their own neighbourhood misclassifies.
+ *
+ * Each sample is compared with its k nearest other samples; it is kept when no label has more
+ * of those neighbours than its own (ties keep it). This drops noisy samples and smooths the
+ * class boundaries. Samples are independent, so they are processed in parallel.
+ *
+ * @param data The training samples.
+ * @param k The number of neighbours that vote.
+ * @return The positions kept, in increasing order.
+ */
+std::vector<size_t> editedNearestNeighbours(const FeatureView &data, int k)
+{
+    size_t dimension = data.dimension();
+    RowKernel distanceKernel = squaredL2Kernel(dimension);
+    std::vector<char> keep(data.size(), 0);
+    parallelFor(data.size(), [&](size_t i)
+                {
+                    thread_local NeighborHeap heap;
+                    heap.reset(static_cast<size_t>(std::max(k, 1)));
+                    for (size_t j = 0; j < data.size(); ++j)
+                    {
+                        if (j != i)
+                        {
+                            heap.push(distanceKernel(data.data(i), data.data(j), dimension), j);
+                        }
+                    }
+
+                    std::map<int, int> votes;
+                    int most = 0;
+                    for (const Neighbor &neighbor : heap.sort())
+                    {
+                        most = std::max(most, ++votes[data.label(neighbor.second)]);
+                    }
+                    keep[i] = votes[data.label(i)] == most; });
+
+    std::vector<size_t> kept;
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        if (keep[i])
+        {
+            kept.push_back(i);
+        }
+    }
+    return kept;
+}
+
+/**
+ * @brief Hart's condensing: keeps a subset of samples that classifies every other one by 1-NN.
+ *
+ * The store starts with the first sample of each label. Each pass walks the samples in order
+ * and adds to the store those that its nearest prototype mislabels, until a pass adds none.
+ * The nearest prototype of every sample among those stored before the pass is updated in
+ * parallel; the sequential walk only compares a sample with the prototypes added during the
+ * pass, so the result is that of the sequential algorithm.
+ *
+ * @param data The training samples.
+ * @return The positions kept, in increasing order.
+ */
+std::vector<size_t> condensedNearestNeighbours(const FeatureView &data)
+{
+    size_t dimension = data.dimension();
+    RowKernel distanceKernel = squaredL2Kernel(dimension);
+    std::vector<size_t> store;
+    std::vector<char> stored(data.size(), 0);
+    std::set<int> labels;
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        if (labels.insert(data.label(i)).second)
+        {
+            store.push_back(i);
+            stored[i] = 1;
+        }
+    }
+
+    // Nearest prototype of each sample among store[0, scanned), as (squared distance, position)
+    std::vector<Neighbor> nearest(data.size(), Neighbor(std::numeric_limits<Accum>::infinity(), data.size()));
+    size_t scanned = 0;
+    bool added = true;
+    while (added)
+    {
+        size_t end = store.size();
+        parallelFor(data.size(), [&](size_t i)
+                    {
+                        for (size_t p = scanned; p < end && !stored[i]; ++p)
+                        {
+                            nearest[i] = std::min(nearest[i], Neighbor(distanceKernel(data.data(i), data.data(store[p]), dimension), store[p]));
+                        } });
+        scanned = end;
+
+        added = false;
+        for (size_t i = 0; i < data.size(); ++i)
+        {
+            if (stored[i])
+            {
+                continue;
+            }
+            Neighbor best = nearest[i];
+            for (size_t p = scanned; p < store.size(); ++p)
+            {
+                best = std::min(best, Neighbor(distanceKernel(data.data(i), data.data(store[p]), dimension), store[p]));
+            }
+            if (data.label(best.second) != data.label(i))
+            {
+                store.push_back(i);
+                stored[i] = 1;
+                added = true;
+            }
+        }
+    }
+
+    std::sort(store.begin(), store.end());
+    return store;
+}
@@ -0,0 +1,355 @@
+#include "../include/QuantizedStore.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include "../include/Parallel.h"
+
+namespace
+{
+    // Independent partial sums of the byte scan (see DistanceKernels.cpp); code rows are padded
+    // to a multiple of the lane count, with zero weights, so the scan has no remainder loop
+    constexpr size_t scanLanes = 8;
+
+    // Pushes the exact distances of the candidates kept by a compressed scan into the heap
+    template <typename Row>
+    void rerankCandidates(const Row &query, NeighborHeap &candidates, const FeatureView &reference, NeighborHeap &heap)
+    {
+        for (const Neighbor &candidate : candidates.sort())
+        {
+            heap.push(squaredEuclidean(query, reference.data(candidate.second), reference.dimension()), candidate.second);
+        }
+    }
+
+    // Nearest codeword of a subspace slice of a sample
+    size_t nearestCodeword(const Scalar *values, const Scalar *codebook, size_t codewords, size_t width)
+    {
+        size_t best = 0;
+        Accum bestDistance = std::numeric_limits<Accum>::infinity();
+        for (size_t c = 0; c < codewords; ++c)
+        {
+            const Scalar *codeword = codebook + c * width;
+            Accum distance = 0.0;
+            for (size_t j = 0; j < width; ++j)
+            {
+                Accum diff = values[j] - codeword[j];
+                distance += diff * diff;
+            }
+            if (distance < bestDistance)
+            {
+                bestDistance = distance;
+                best = c;
+            }
+        }
+        return best;
+    }
+}
+
+/**
+ * @brief Quantizes the samples of a view to one signed byte per feature.
+ *
+ * The range of each feature over the samples is mapped linearly onto [-127, 127], so the
+ * rounding error of a feature is at most half of its range / 254.
+ *
+ * @param data The indexed samples (their positions are returned by the searches).
+ * @param parameters The store settings (only rerank is used).
+ */
+void Int8Store::build(const FeatureView &data, const QuantizationParameters &parameters)
+{
+    settings = parameters;
+    reference = data;
+    count = data.size();
+    dimension = data.dimension();
+    centers.assign(dimension, 0.0);
+    steps.assign(dimension, 0.0);
+    codeStride = (dimension + scanLanes - 1) / scanLanes * scanLanes;
+    weights.assign(codeStride, 0.0f);
+    codes.assign(count * codeStride, 0);
+    if (count == 0)
+    {
+        return;
+    }
+
+    for (size_t j = 0; j < dimension; ++j)
+    {
+        Accum low = data.data(0)[j], high = low;
+        for (size_t i = 1; i < count; ++i)
+        {
+            low = std::min<Accum>(low, data.data(i)[j]);
+            high = std::max<Accum>(high, data.data(i)[j]);
+        }
+        centers[j] = (low + high) / 2;
+        steps[j] = (high - low) / 254;
+        weights[j] = static_cast<float>(steps[j] * steps[j]);
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        encode(data.data(i), &codes[i * codeStride]);
+    }
+}
+
+/**
+ * @brief Rounds a sample to code units of the store's ranges, clamped to [-127, 127].
+ *
+ * @param values The sample's features.
+ * @param code Receives the dimension codes (the padding is left untouched).
+ */
+void Int8Store::encode(const Scalar *values, int8_t *code) const
+{
+    for (size_t j = 0; j < dimension; ++j)
+    {
+        Accum units = steps[j] > 0 ? std::round((values[j] - centers[j]) / steps[j]) : 0.0;
+        code[j] = static_cast<int8_t>(std::max<Accum>(-127, std::min<Accum>(127, units)));
+    }
+}
+
+/**
+ * @brief Appends the codes of one more sample, in O(d).
+ *
+ * The ranges are not retrained: a feature outside its build() range is clamped, which only
+ * coarsens the scan (the re-ranking uses exact distances). The indexed view must already hold
+ * the sample as row sourceIndex of its matrix (see rebind()).
+ *
+ * @param sample The new sample.
+ * @param sourceIndex The row of the sample in the matrix of the indexed view.
+ */
+void Int8Store::add(const FeatureRow &sample, size_t sourceIndex)
+{
+    codes.resize((count + 1) * codeStride, 0);
+    encode(sample.values, &codes[count * codeStride]);
+    reference.appendIndex(sourceIndex);
+    ++count;
+}
+
+/**
+ * @brief Returns the memory used by the compressed samples.
+ *
+ * @return The size of the codes and of the per-feature ranges, in bytes.
+ */
+size_t Int8Store::memoryBytes() const
+{
+    return codes.size() * sizeof(int8_t) + (centers.size() + steps.size()) * sizeof(Accum) + weights.size() * sizeof(float);
+}
+
+/**
+ * @brief Finds the nearest samples of a query through the byte codes.
+ *
+ * The scan computes the distance between the exact query and each decoded sample in code
+ * units, in single precision (it only ranks candidates), keeping max(rerank, k) of them;
+ * their exact distances decide the neighbours.
+ *
+ * @param query The query sample.
+ * @param heap Receives the re-ranked candidates; its size sets the number of neighbours.
+ */
+template <typename Row>
+void Int8Store::search(const Row &query, NeighborHeap &heap) const
+{
+    thread_local std::vector<float> units; // Query in code units of each feature
+
+    units.assign(codeStride, 0.0f);
+    for (size_t j = 0; j < dimension; ++j)
+    {
+        units[j] = steps[j] > 0 ? static_cast<float>((query[j] - centers[j]) / steps[j]) : 0.0f;
+    }
+
+    // Constant features add the same distance to every sample: they have no weight in the scan
+    thread_local NeighborHeap candidates;
+    candidates.reset(std::max(settings.rerank, heap.capacity()));
+    for (size_t i = 0; i < count; ++i)
+    {
+        const int8_t *code = &codes[i * codeStride];
+        float sums[scanLanes] = {};
+        for (size_t p = 0; p < codeStride; p += scanLanes)
+        {
+            for (size_t l = 0; l < scanLanes; ++l)
+            {
+                float diff = units[p + l] - code[p + l];
+                sums[l] += weights[p + l] * diff * diff;
+            }
+        }
+        float distance = 0.0f;
+        for (size_t l = 0; l < scanLanes; ++l)
+        {
+            distance += sums[l];
+        }
+        candidates.push(distance, i);
+    }
+    rerankCandidates(query, candidates, reference, heap);
+}
+
+/**
+ * @brief Trains one codebook per subspace and encodes the samples of a view.
+ *
+ * Each codebook is trained by k-means on the samples' slice of the features, starting from
+ * randomly chosen samples (with a fixed seed, so the codes are reproducible). Subspaces are
+ * trained in parallel.
+ *
+ * @param data The indexed samples (their positions are returned by the searches).
+ * @param parameters The quantizer settings.
+ */
+void ProductQuantizer::build(const FeatureView &data, const QuantizationParameters &parameters)
+{
+    settings = parameters;
+    reference = data;
+    count = data.size();
+    dimension = data.dimension();
+    if (count == 0)
+    {
+        codes.clear();
+        return;
+    }
+
+    size_t width = std::max<size_t>(settings.subspaceWidth, 1);
+    subspaceCount = (dimension + width - 1) / width;
+    codewords = std::max<size_t>(std::min({settings.centroids, size_t(256), count}), 1);
+    subspaceBegin.resize(subspaceCount + 1);
+    codebookOffset.resize(subspaceCount + 1);
+    codebookOffset[0] = 0;
+    for (size_t s = 0; s <= subspaceCount; ++s)
+    {
+        subspaceBegin[s] = s * dimension / subspaceCount; // Widths differ by at most one feature
+        if (s > 0)
+        {
+            codebookOffset[s] = codebookOffset[s - 1] + codewords * (subspaceBegin[s] - subspaceBegin[s - 1]);
+        }
+    }
+    codebooks.assign(codebookOffset[subspaceCount], 0.0);
+    codes.assign(count * subspaceCount, 0);
+
+    parallelFor(subspaceCount, [&](size_t s)
+                {
+                    size_t begin = subspaceBegin[s];
+                    size_t sliceWidth = subspaceBegin[s + 1] - begin;
+                    Scalar *codebook = &codebooks[codebookOffset[s]];
+
+                    // Initial codewords: distinct samples
+                    std::vector<size_t> order(count);
+                    std::iota(order.begin(), order.end(), 0);
+                    std::shuffle(order.begin(), order.end(), std::mt19937(static_cast<unsigned>(s + 1)));
+                    for (size_t c = 0; c < codewords; ++c)
+                    {
+                        std::copy(data.data(order[c]) + begin, data.data(order[c]) + begin + sliceWidth, codebook + c * sliceWidth);
+                    }
+
+                    std::vector<size_t> assignment(count);
+                    std::vector<Accum> sums(codewords * sliceWidth);
+                    std::vector<size_t> sizes(codewords);
+                    for (size_t round = 0; round <= settings.trainingRounds; ++round)
+                    {
+                        for (size_t i = 0; i < count; ++i)
+                        {
+                            assignment[i] = nearestCodeword(data.data(i) + begin, codebook, codewords, sliceWidth);
+                        }
+                        if (round == settings.trainingRounds)
+                        {
+                            break; // The last assignment gives the codes
+                        }
+
+                        std::fill(sums.begin(), sums.end(), 0.0);
+                        std::fill(sizes.begin(), sizes.end(), 0);
+                        for (size_t i = 0; i < count; ++i)
+                        {
+                            const Scalar *values = data.data(i) + begin;
+                            for (size_t j = 0; j < sliceWidth; ++j)
+                            {
+                                sums[assignment[i] * sliceWidth + j] += values[j];
+                            }
+                            ++sizes[assignment[i]];
+                        }
+                        for (size_t c = 0; c < codewords; ++c)
+                        {
+                            for (size_t j = 0; j < sliceWidth && sizes[c] > 0; ++j) // Empty clusters keep their codeword
+                            {
+                                codebook[c * sliceWidth + j] = static_cast<Scalar>(sums[c * sliceWidth + j] / sizes[c]);
+                            }
+                        }
+                    }
+
+                    for (size_t i = 0; i < count; ++i)
+                    {
+                        codes[i * subspaceCount + s] = static_cast<uint8_t>(assignment[i]);
+                    } });
+}
+
+/**
+ * @brief Appends the codes of one more sample, in O(codewords x d).
+ *
+ * Each subspace slice gets its nearest codeword; the codebooks are not retrained. The indexed
+ * view must already hold the sample as row sourceIndex of its matrix (see rebind()).
+ *
+ * @param sample The new sample.
+ * @param sourceIndex The row of the sample in the matrix of the indexed view.
+ */
+void ProductQuantizer::add(const FeatureRow &sample, size_t sourceIndex)
+{
+    codes.resize((count + 1) * subspaceCount);
+    for (size_t s = 0; s < subspaceCount; ++s)
+    {
+        size_t begin = subspaceBegin[s];
+        codes[count * subspaceCount + s] = static_cast<uint8_t>(
+            nearestCodeword(sample.values + begin, &codebooks[codebookOffset[s]], codewords, subspaceBegin[s + 1] - begin));
+    }
+    reference.appendIndex(sourceIndex);
+    ++count;
+}
+
+/**
+ * @brief Returns the memory used by the compressed samples.
+ *
+ * @return The size of the codes and of the codebooks, in bytes.
+ */
+size_t ProductQuantizer::memoryBytes() const
+{
+    return codes.size() * sizeof(uint8_t) + codebooks.size() * sizeof(Scalar);
+}
+
+/**
+ * @brief Finds the nearest samples of a query through the product codes.
+ *
+ * The squared distances from the query to every codeword are tabulated first; the distance
+ * to a sample is then the sum of one table entry per subspace. The max(rerank, k) best
+ * candidates are re-ranked with their exact distances.
+ *
+ * @param query The query sample.
+ * @param heap Receives the re-ranked candidates; its size sets the number of neighbours.
+ */
+template <typename Row>
+void ProductQuantizer::search(const Row &query, NeighborHeap &heap) const
+{
+    thread_local std::vector<Accum> table; // subspaceCount x codewords
+    thread_local NeighborHeap candidates;
+
+    table.resize(subspaceCount * codewords);
+    for (size_t s = 0; s < subspaceCount; ++s)
+    {
+        size_t begin = subspaceBegin[s];
+        size_t sliceWidth = subspaceBegin[s + 1] - begin;
+        const Scalar *codebook = &codebooks[codebookOffset[s]];
+        for (size_t c = 0; c < codewords; ++c)
+        {
+            Accum distance = 0.0;
+            for (size_t j = 0; j < sliceWidth; ++j)
+            {
+                Accum diff = query[begin + j] - codebook[c * sliceWidth + j];
+                distance += diff * diff;
+            }
+            table[s * codewords + c] = distance;
+        }
+    }
+
+    candidates.reset(std::max(settings.rerank, heap.capacity()));
+    for (size_t i = 0; i < count; ++i)
+    {
+        const uint8_t *code = &codes[i * subspaceCount];
+        Accum distance = 0.0;
+        for (size_t s = 0; s < subspaceCount; ++s)
+        {
+            distance += table[s * codewords + code[s]];
+        }
+        candidates.push(distance, i);
+    }
+    rerankCandidates(query, candidates, reference, heap);
+}
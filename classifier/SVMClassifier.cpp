@@ -5,6 +5,7 @@
 #include <numeric>
 #include <limits>
 #include <random>
+#include "../include/DistanceKernels.h"
 
 /**
  * @brief Constructs an SVMClassifier with specified learning rate and maximum iterations.
@@ -25,15 +26,15 @@ SVMClassifier::SVMClassifier(double learningRate, int maxIterations)
  * bias if the margin is violated (i.e., if the point is on the wrong side of the
  * decision boundary).
  *
- * @param trainingData A vector of DataPoint objects containing features and labels for training.
+ * @param trainingData A selection of samples containing features and labels for training.
  */
-void SVMClassifier::train(const std::vector<DataPoint> &trainingData)
+void SVMClassifier::train(const FeatureView &trainingData)
 {
     // Check if training data is empty
     if (trainingData.empty())
         return;
 
-    size_t featureSize = trainingData[0].features.size();
+    size_t featureSize = trainingData.dimension();
     weights.resize(featureSize, 0.0); // Initialize weights to zero
 
     // Iterate over the training process for the maximum number of iterations
@@ -42,18 +43,18 @@ void SVMClassifier::train(const std::vector<DataPoint> &trainingData)
         bool updated = false;
 
         // Go through each data point and update the weights if necessary
-        for (const auto &point : trainingData)
+        for (const FeatureRow point : trainingData)
         {
             // Calculate the margin for the point
-            double dotProduct = std::inner_product(point.features.begin(), point.features.end(), weights.begin(), 0.0);
-            double margin = point.label * (dotProduct + bias);
+            Accum dotProduct = std::inner_product(point.begin(), point.end(), weights.begin(), Accum(0));
+            Accum margin = point.label * (dotProduct + bias);
 
             // Update the weights and bias if the margin condition is violated
             if (margin <= 0)
             {
                 for (size_t i = 0; i < featureSize; ++i)
                 {
-                    weights[i] += learningRate * point.label * point.features[i];
+                    weights[i] += learningRate * point.label * point[i];
                 }
                 bias += learningRate * point.label;
                 updated = true;
@@ -72,56 +73,41 @@ void SVMClassifier::train(const std::vector<DataPoint> &trainingData)
  * Computes the decision function (dot product of features and weights + bias)
  * and returns the predicted label based on the sign of the result.
  *
- * @param point The DataPoint for which the label is to be predicted.
+ * @param point The sample for which the label is to be predicted.
  * @return The predicted label (1 or -1).
  */
-int SVMClassifier::predict(const DataPoint &point) const
+template <typename Row>
+int SVMClassifier::predict(const Row &point) const
 {
-    double dotProduct = std::inner_product(point.features.begin(), point.features.end(), weights.begin(), 0.0);
-    return (dotProduct + bias >= 0) ? 1 : -1; // Predict 1 if score is >= 0, else -1
+    return (decisionValue(point) >= 0) ? 1 : -1; // Predict 1 if score is >= 0, else -1
 }
 
 /**
- * @brief Normalizes the feature values of the given dataset.
+ * @brief Predicts the label for a data point and returns the decision score.
  *
- * Each feature in a DataPoint is divided by the Euclidean norm (magnitude) of the feature vector.
- * This ensures that each feature vector has a unit norm, making training more efficient.
+ * Similar to the `predict` function, but also returns the score (the result of
+ * the decision function), which gives a measure of confidence in the prediction.
  *
- * @param data The dataset to be normalized.
- * @return A new dataset with normalized feature values.
+ * @param point The sample to be predicted.
+ * @return A pair consisting of the predicted label and the decision score.
  */
-std::vector<DataPoint> SVMClassifier::normalizeData(const std::vector<DataPoint> &data) const
+template <typename Row>
+std::pair<int, double> SVMClassifier::predictWithScore(const Row &point) const
 {
-    std::vector<DataPoint> normalizedData = data;
-
-    // Normalize each data point's features
-    for (auto &point : normalizedData)
-    {
-        double norm = std::sqrt(std::inner_product(point.features.begin(), point.features.end(), point.features.begin(), 0.0));
-        if (norm > 0)
-        {
-            for (auto &feature : point.features)
-            {
-                feature /= norm; // Normalize by dividing each feature by the norm
-            }
-        }
-    }
-
-    return normalizedData;
+    double score = decisionValue(point);
+    return {(score >= 0) ? 1 : -1, score}; // Return label and score (the score can be used for confidence)
 }
 
 /**
- * @brief Predicts the label for a data point and returns the decision score.
+ * @brief Evaluates the decision function of the trained model on a data point.
  *
- * Similar to the `predict` function, but also returns the score (the result of
- * the decision function), which gives a measure of confidence in the prediction.
- *
- * @param point The DataPoint to be predicted.
- * @return A pair consisting of the predicted label and the decision score.
+ * @param point The sample (raw features or a row normalized on the fly, read once into
+ * contiguous memory for the dot-product kernel).
+ * @return The dot product of the features and the weights, plus the bias.
  */
-std::pair<int, double> SVMClassifier::predictWithScore(const DataPoint &point) const
+template <typename Row>
+Accum SVMClassifier::decisionValue(const Row &point) const
 {
-    double dotProduct = std::inner_product(point.features.begin(), point.features.end(), weights.begin(), 0.0);
-    double score = dotProduct + bias;
-    return {(score >= 0) ? 1 : -1, score}; // Return label and score (the score can be used for confidence)
+    FeatureRow values = contiguousRow(point);
+    return dotProduct(values.values, weights.data(), values.size()) + bias;
 }
\ No newline at end of file
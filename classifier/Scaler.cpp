@@ -0,0 +1,191 @@
+#include "../include/Scaler.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+/**
+ * @brief Fits the mean and standard deviation of every feature in a single pass.
+ *
+ * Uses Welford's update, which reads each sample once and stays accurate when the mean is
+ * large compared to the spread. The running statistics are kept per feature in contiguous
+ * arrays, so each update is a branch-free loop over the features.
+ *
+ * @param data The training data.
+ */
+void StandardScaler::fit(const FeatureView &data)
+{
+    if (data.empty())
+    {
+        throw std::invalid_argument("Cannot fit a scaler on empty data.");
+    }
+
+    size_t dimension = data.dimension();
+    std::vector<Accum> runningMean(dimension, 0.0);
+    std::vector<Accum> squaredDeviations(dimension, 0.0); // Welford's M2
+
+    for (size_t n = 0; n < data.size(); ++n)
+    {
+        const Scalar *values = data.data(n);
+        Accum inverseCount = Accum(1) / (n + 1);
+        for (size_t i = 0; i < dimension; ++i)
+        {
+            Accum delta = values[i] - runningMean[i];
+            runningMean[i] += delta * inverseCount;
+            squaredDeviations[i] += delta * (values[i] - runningMean[i]);
+        }
+    }
+
+    means.resize(dimension);
+    inverseStdDevs.resize(dimension);
+    for (size_t i = 0; i < dimension; ++i)
+    {
+        Accum stdDev = std::sqrt(squaredDeviations[i] / data.size()); // Population standard deviation
+        means[i] = static_cast<Scalar>(runningMean[i]);
+        inverseStdDevs[i] = stdDev > 1e-10 ? static_cast<Scalar>(1.0 / stdDev) : Scalar(0);
+    }
+}
+
+/**
+ * @brief Normalizes every row of a matrix in place.
+ *
+ * @param data The samples to normalize, with the dimension the scaler was fitted on.
+ */
+void StandardScaler::transform(FeatureMatrix &data) const
+{
+    for (size_t row = 0; row < data.size(); ++row)
+    {
+        transform(data.data(row), data.dimension());
+    }
+}
+
+/**
+ * @brief Normalizes one sample in place.
+ *
+ * @param values The features of the sample.
+ * @param dimension The number of features (must match the fitted data).
+ */
+void StandardScaler::transform(Scalar *values, size_t dimension) const
+{
+    Row scaled = bind(FeatureRow(values, dimension, 0));
+    for (size_t i = 0; i < dimension; ++i)
+    {
+        values[i] = scaled[i];
+    }
+}
+
+/**
+ * @brief Wraps a raw sample so that each read returns the normalized feature.
+ *
+ * @param row The raw sample, with the dimension the scaler was fitted on.
+ * @return The normalized accessor, valid while the sample and the scaler are.
+ */
+StandardScaler::Row StandardScaler::bind(const FeatureRow &row) const
+{
+    if (row.size() != means.size())
+    {
+        throw std::invalid_argument("Sample dimension does not match the fitted scaler.");
+    }
+    return Row{row.values, means.data(), inverseStdDevs.data(), row.size(), row.label};
+}
+
+/**
+ * @brief Scales every row of a matrix to unit norm, in place.
+ *
+ * @param data The samples to normalize.
+ */
+void L2Scaler::transform(FeatureMatrix &data) const
+{
+    for (size_t row = 0; row < data.size(); ++row)
+    {
+        transform(data.data(row), data.dimension());
+    }
+}
+
+/**
+ * @brief Scales one sample to unit norm, in place. Null samples are left unchanged.
+ *
+ * @param values The features of the sample.
+ * @param dimension The number of features.
+ */
+void L2Scaler::transform(Scalar *values, size_t dimension) const
+{
+    Row scaled = bind(FeatureRow(values, dimension, 0));
+    for (size_t i = 0; i < dimension; ++i)
+    {
+        values[i] = scaled[i];
+    }
+}
+
+/**
+ * @brief Computes the norm of a raw sample and wraps it so that each read returns the
+ * feature divided by that norm. Null samples are read unchanged.
+ *
+ * @param row The raw sample.
+ * @return The normalized accessor, valid while the sample is.
+ */
+L2Scaler::Row L2Scaler::bind(const FeatureRow &row) const
+{
+    Accum squaredNorm = 0.0;
+    for (size_t i = 0; i < row.size(); ++i)
+    {
+        squaredNorm += Accum(row[i]) * row[i];
+    }
+    Scalar inverseNorm = squaredNorm > 0 ? static_cast<Scalar>(1.0 / std::sqrt(squaredNorm)) : Scalar(1);
+    return Row{row.values, Scalar(0), inverseNorm, row.size(), row.label};
+}
+
+/**
+ * @brief Applies the per-sample Z-score to every row of a matrix, in place.
+ *
+ * @param data The samples to normalize.
+ */
+void SampleStandardScaler::transform(FeatureMatrix &data) const
+{
+    for (size_t row = 0; row < data.size(); ++row)
+    {
+        transform(data.data(row), data.dimension());
+    }
+}
+
+/**
+ * @brief Centres one sample on the mean of its features and divides it by their standard
+ * deviation, in place. Samples whose features are all equal are mapped to 0.
+ *
+ * @param values The features of the sample.
+ * @param dimension The number of features.
+ */
+void SampleStandardScaler::transform(Scalar *values, size_t dimension) const
+{
+    Row scaled = bind(FeatureRow(values, dimension, 0));
+    for (size_t i = 0; i < dimension; ++i)
+    {
+        values[i] = scaled[i];
+    }
+}
+
+/**
+ * @brief Computes the mean and standard deviation of the features of a raw sample and
+ * wraps it so that each read returns the Z-scored feature.
+ *
+ * @param row The raw sample.
+ * @return The normalized accessor, valid while the sample is.
+ */
+SampleStandardScaler::Row SampleStandardScaler::bind(const FeatureRow &row) const
+{
+    size_t dimension = row.size();
+    if (dimension == 0)
+    {
+        return Row{row.values, Scalar(0), Scalar(1), 0, row.label};
+    }
+
+    Accum sum = 0.0, squaredSum = 0.0;
+    for (size_t i = 0; i < dimension; ++i)
+    {
+        sum += row[i];
+        squaredSum += Accum(row[i]) * row[i];
+    }
+    Accum mean = sum / dimension;
+    Accum variance = std::max(Accum(0), squaredSum / dimension - mean * mean);
+    Scalar inverseStdDev = variance > 0 ? static_cast<Scalar>(1.0 / std::sqrt(variance)) : Scalar(0);
+    return Row{row.values, static_cast<Scalar>(mean), inverseStdDev, dimension, row.label};
+}
@@ -0,0 +1,122 @@
+#include "../include/GFDExtractor.h"
+#include <algorithm>
+#include <cmath>
+#include <complex>
+
+/**
+ * @brief Computes the GFD of a shape image.
+ *
+ * @param image The shape image.
+ * @return The 100 descriptor values.
+ */
+std::vector<double> GFDExtractor::compute(const PGMImage &image) const
+{
+    std::vector<double> descriptor;
+    preprocessor.processImage(image, [&](size_t, const NormalizedShape &shape)
+                              { descriptor = compute(shape); });
+    return descriptor;
+}
+
+/**
+ * @brief Computes the GFD of a normalized shape.
+ *
+ * The polar Fourier transform PF(rho, phi) = sum over the shape pixels of
+ * exp(-i (2 pi rho r / R + phi theta)) is evaluated exactly, pixel by pixel, as the .gfd files
+ * were: (r, theta) are the polar coordinates of a pixel around the centroid truncated to whole
+ * pixels, and R is the largest such r. Both exponentials are separable, so each pixel costs
+ * one square root, the powers of exp(-2 pi i r / R) and exp(-i theta) (built by products, from
+ * the pixel offset), and one complex multiply-add per coefficient.
+ *
+ * As in the .gfd files, the first value is the area divided by that of the disk of radius R,
+ * and the others are |PF(rho, phi)| / |PF(0, 0)| for rho < 10 and phi < 10, rho-major.
+ *
+ * @param shape The normalized shape.
+ * @return The 100 descriptor values.
+ */
+std::vector<double> GFDExtractor::compute(const NormalizedShape &shape) const
+{
+    double centerX = std::floor(shape.frame.centroidX);
+    double centerY = std::floor(shape.frame.centroidY);
+    double maxSquared = 0.0;
+    for (int y = 0; y < shape.height; ++y)
+    {
+        for (int x = 0; x < shape.width; ++x)
+        {
+            if (shape.isShape(x, y))
+            {
+                maxSquared = std::max(maxSquared, (x - centerX) * (x - centerX) + (y - centerY) * (y - centerY));
+            }
+        }
+    }
+    double maxRadius = std::sqrt(maxSquared);
+    double inverseRadius = maxRadius > 0 ? 1.0 / maxRadius : 0.0;
+
+    std::complex<double> transform[radialFrequencies][angularFrequencies] = {};
+    std::complex<double> radialPowers[radialFrequencies];
+    std::complex<double> angularPowers[angularFrequencies];
+    for (int y = 0; y < shape.height; ++y)
+    {
+        for (int x = 0; x < shape.width; ++x)
+        {
+            if (!shape.isShape(x, y))
+            {
+                continue;
+            }
+            double dx = x - centerX;
+            double dy = y - centerY;
+            double distance = std::sqrt(dx * dx + dy * dy);
+            std::complex<double> radialStep = std::polar(1.0, -2.0 * M_PI * distance * inverseRadius);
+            std::complex<double> angularStep = distance > 0 ? std::complex<double>(dx, -dy) / distance : 1.0;
+            radialPowers[0] = angularPowers[0] = 1.0;
+            for (int rho = 1; rho < radialFrequencies; ++rho)
+            {
+                radialPowers[rho] = radialPowers[rho - 1] * radialStep;
+            }
+            for (int phi = 1; phi < angularFrequencies; ++phi)
+            {
+                angularPowers[phi] = angularPowers[phi - 1] * angularStep;
+            }
+            for (int rho = 0; rho < radialFrequencies; ++rho)
+            {
+                for (int phi = 0; phi < angularFrequencies; ++phi)
+                {
+                    transform[rho][phi] += radialPowers[rho] * angularPowers[phi];
+                }
+            }
+        }
+    }
+
+    // Normalize by the DC term (the area)
+    double dc = std::abs(transform[0][0]);
+    std::vector<double> descriptor;
+    descriptor.reserve(radialFrequencies * angularFrequencies);
+    descriptor.push_back(maxRadius > 0 ? shape.frame.area / (M_PI * maxSquared) : 0.0);
+    for (int rho = 0; rho < radialFrequencies; ++rho)
+    {
+        for (int phi = 0; phi < angularFrequencies; ++phi)
+        {
+            if (rho == 0 && phi == 0)
+            {
+                continue;
+            }
+            descriptor.push_back(dc > 0 ? std::abs(transform[rho][phi]) / dc : 0.0);
+        }
+    }
+    return descriptor;
+}
+
+/**
+ * @brief Computes the descriptor of every image of a corpus directory.
+ *
+ * Images are decoded, normalized and transformed in parallel on the shared thread pool.
+ *
+ * @param corpusPath The directory holding the "sXXnYYY.pgm" images.
+ * @param sourceNames If not null, receives the file name of each returned sample.
+ * @return One DataPoint per image, labelled with its class number.
+ */
+std::vector<DataPoint> GFDExtractor::extractCorpus(const std::string &corpusPath,
+                                                   std::vector<std::string> *sourceNames) const
+{
+    return preprocessor.featurizeCorpus(corpusPath, [this](const NormalizedShape &shape)
+                                        { return compute(shape); }, sourceNames);
+}
@@ -0,0 +1,124 @@
+#include "../include/PGMImage.h"
+#include "../include/SignatureLoader.h"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+namespace
+{
+    // Reads the next header token, skipping whitespace and '#' comments
+    std::string readHeaderToken(std::istream &in)
+    {
+        std::string token;
+        int c;
+        while ((c = in.get()) != EOF)
+        {
+            if (c == '#')
+            {
+                while ((c = in.get()) != EOF && c != '\n')
+                {
+                }
+            }
+            else if (std::isspace(c))
+            {
+                if (!token.empty())
+                {
+                    break;
+                }
+            }
+            else
+            {
+                token.push_back(static_cast<char>(c));
+            }
+        }
+        return token;
+    }
+}
+
+/**
+ * @brief Reads a binary (P5) or ASCII (P2) PGM file.
+ *
+ * Grey levels are rescaled to 0-255 when the file's maximum value differs.
+ *
+ * @param path The path of the PGM file.
+ * @return The decoded image.
+ */
+PGMImage PGMImage::read(const std::string &path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open())
+    {
+        throw std::runtime_error("Unable to open image: " + path);
+    }
+
+    std::string magic = readHeaderToken(in);
+    if (magic != "P5" && magic != "P2")
+    {
+        throw std::runtime_error("Unsupported PGM format in " + path);
+    }
+
+    PGMImage image;
+    image.width = std::stoi(readHeaderToken(in));
+    image.height = std::stoi(readHeaderToken(in));
+    int maxValue = std::stoi(readHeaderToken(in));
+    if (image.width <= 0 || image.height <= 0 || maxValue <= 0 || maxValue > 255)
+    {
+        throw std::runtime_error("Unsupported PGM header in " + path);
+    }
+
+    size_t pixelCount = static_cast<size_t>(image.width) * image.height;
+    image.pixels.resize(pixelCount);
+    if (magic == "P5")
+    {
+        in.read(reinterpret_cast<char *>(image.pixels.data()), static_cast<std::streamsize>(pixelCount));
+    }
+    else
+    {
+        for (auto &pixel : image.pixels)
+        {
+            int value;
+            in >> value;
+            pixel = static_cast<unsigned char>(value);
+        }
+    }
+    if (!in)
+    {
+        throw std::runtime_error("Truncated PGM data in " + path);
+    }
+
+    if (maxValue != 255)
+    {
+        for (auto &pixel : image.pixels)
+        {
+            pixel = static_cast<unsigned char>(pixel * 255 / maxValue);
+        }
+    }
+    return image;
+}
+
+/**
+ * @brief Lists the shape images of a corpus directory.
+ *
+ * @param directory The directory holding "sXXnYYY.pgm" files.
+ * @return The entries sorted by file name, labelled with their class number.
+ */
+std::vector<CorpusEntry> PGMImage::listCorpus(const std::string &directory)
+{
+    std::vector<CorpusEntry> entries;
+    for (const auto &file : std::filesystem::directory_iterator(directory))
+    {
+        std::string name = file.path().filename().string();
+        int label, sample;
+        if (file.is_regular_file() && file.path().extension() == ".pgm" &&
+            SignatureLoader::parseSampleName(name, label, sample))
+        {
+            entries.push_back({name, file.path().string(), label});
+        }
+    }
+    std::sort(entries.begin(), entries.end(),
+              [](const CorpusEntry &a, const CorpusEntry &b)
+              { return a.name < b.name; });
+    return entries;
+}
@@ -0,0 +1,340 @@
+#include "../include/ShapePreprocessor.h"
+#include "../include/Parallel.h"
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    // Read-only mapping of a whole file, released on scope exit
+    class MappedFile
+    {
+    public:
+        explicit MappedFile(const std::string &path)
+        {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+            {
+                throw std::runtime_error("Unable to open image: " + path);
+            }
+            struct stat info;
+            if (fstat(fd, &info) != 0 || info.st_size == 0)
+            {
+                ::close(fd);
+                throw std::runtime_error("Unable to read image: " + path);
+            }
+            length = static_cast<size_t>(info.st_size);
+            void *address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if (address == MAP_FAILED)
+            {
+                throw std::runtime_error("Unable to map image: " + path);
+            }
+            bytes = static_cast<const char *>(address);
+        }
+
+        ~MappedFile()
+        {
+            munmap(const_cast<char *>(bytes), length);
+        }
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        const char *begin() const { return bytes; }
+        const char *end() const { return bytes + length; }
+
+    private:
+        const char *bytes = nullptr;
+        size_t length = 0;
+    };
+
+    // Skips whitespace and '#' comments of a PGM header
+    const char *skipSeparators(const char *current, const char *end)
+    {
+        while (current < end)
+        {
+            if (*current == '#')
+            {
+                while (current < end && *current != '\n')
+                {
+                    ++current;
+                }
+            }
+            else if (std::isspace(static_cast<unsigned char>(*current)))
+            {
+                ++current;
+            }
+            else
+            {
+                break;
+            }
+        }
+        return current;
+    }
+
+    // Parses the next unsigned integer of a PGM header or P2 body
+    const char *readNumber(const char *current, const char *end, int &value, const std::string &path)
+    {
+        current = skipSeparators(current, end);
+        auto [next, error] = std::from_chars(current, end, value);
+        if (error != std::errc())
+        {
+            throw std::runtime_error("Malformed PGM file: " + path);
+        }
+        return next;
+    }
+}
+
+// Buffers kept by each thread between images
+struct ShapePreprocessor::Buffers
+{
+    std::vector<unsigned char> mask;
+    std::vector<double> unitX;
+    std::vector<double> unitY;
+    std::vector<unsigned char> canvas;
+};
+
+/**
+ * @brief Returns the buffers of the calling thread.
+ *
+ * They only grow, so once the largest image has been seen no further allocation happens.
+ */
+ShapePreprocessor::Buffers &ShapePreprocessor::threadBuffers()
+{
+    thread_local Buffers buffers;
+    return buffers;
+}
+
+/**
+ * @brief Decodes and normalizes a batch of PGM files on the shared thread pool.
+ *
+ * @param paths The image files.
+ * @param callback Called once per image, with its index in paths, on the worker thread that
+ *                 processed it. The shape's buffers are reused after the callback returns.
+ */
+void ShapePreprocessor::processBatch(const std::vector<std::string> &paths, const Callback &callback) const
+{
+    parallelFor(paths.size(), [&](size_t i)
+                { processFile(paths[i], callback, i); });
+}
+
+/**
+ * @brief Computes a descriptor for every image of a corpus directory.
+ *
+ * @param corpusPath The directory holding the "sXXnYYY.pgm" images.
+ * @param descriptor The descriptor computation, called on the worker threads.
+ * @param sourceNames If not null, receives the file name of each returned sample.
+ * @return One DataPoint per image (sorted by name), labelled with its class number.
+ */
+std::vector<DataPoint> ShapePreprocessor::featurizeCorpus(const std::string &corpusPath,
+                                                          const std::function<std::vector<double>(const NormalizedShape &)> &descriptor,
+                                                          std::vector<std::string> *sourceNames) const
+{
+    std::vector<CorpusEntry> entries = PGMImage::listCorpus(corpusPath);
+    std::vector<std::string> paths;
+    std::vector<DataPoint> data(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        paths.push_back(entries[i].path);
+        data[i].label = entries[i].label;
+    }
+
+    processBatch(paths, [&](size_t i, const NormalizedShape &shape)
+                 { data[i].features = descriptor(shape); });
+
+    if (sourceNames)
+    {
+        sourceNames->clear();
+        for (const auto &entry : entries)
+        {
+            sourceNames->push_back(entry.name);
+        }
+    }
+    return data;
+}
+
+/**
+ * @brief Decodes a PGM file straight from its memory mapping and normalizes its shape.
+ *
+ * P5 pixels are binarized while they are read from the mapping, so the raw image is never
+ * copied; P2 values are parsed with std::from_chars. A pixel belongs to the shape when its
+ * grey level is below half of the maximum value (black shapes on a white background).
+ *
+ * @param path The image file.
+ * @param callback Called with the normalized shape.
+ * @param index The index passed to the callback.
+ */
+void ShapePreprocessor::processFile(const std::string &path, const Callback &callback, size_t index) const
+{
+    MappedFile file(path);
+    const char *current = file.begin();
+    const char *end = file.end();
+
+    if (end - current < 2 || current[0] != 'P' || (current[1] != '5' && current[1] != '2'))
+    {
+        throw std::runtime_error("Unsupported PGM format in " + path);
+    }
+    bool binary = current[1] == '5';
+    current += 2;
+
+    int width, height, maxValue;
+    current = readNumber(current, end, width, path);
+    current = readNumber(current, end, height, path);
+    current = readNumber(current, end, maxValue, path);
+    if (width <= 0 || height <= 0 || maxValue <= 0 || maxValue > 255)
+    {
+        throw std::runtime_error("Unsupported PGM header in " + path);
+    }
+
+    Buffers &buffers = threadBuffers();
+    size_t pixelCount = static_cast<size_t>(width) * height;
+    buffers.mask.resize(pixelCount);
+
+    if (binary)
+    {
+        ++current; // Single whitespace between the header and the pixels
+        if (static_cast<size_t>(end - current) < pixelCount)
+        {
+            throw std::runtime_error("Truncated PGM data in " + path);
+        }
+        const unsigned char *pixels = reinterpret_cast<const unsigned char *>(current);
+        for (size_t i = 0; i < pixelCount; ++i)
+        {
+            buffers.mask[i] = pixels[i] * 255 < 128 * maxValue;
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < pixelCount; ++i)
+        {
+            int value;
+            current = readNumber(current, end, value, path);
+            buffers.mask[i] = value * 255 < 128 * maxValue;
+        }
+    }
+
+    normalize(buffers, width, height, callback, index);
+}
+
+/**
+ * @brief Binarizes an already decoded image and normalizes its shape.
+ *
+ * @param image The image.
+ * @param callback Called with the normalized shape.
+ */
+void ShapePreprocessor::processImage(const PGMImage &image, const Callback &callback) const
+{
+    Buffers &buffers = threadBuffers();
+    buffers.mask.resize(image.pixels.size());
+    for (size_t i = 0; i < image.pixels.size(); ++i)
+    {
+        buffers.mask[i] = image.pixels[i] < 128;
+    }
+    normalize(buffers, image.width, image.height, callback, 0);
+}
+
+/**
+ * @brief Translates the binarized shape to its centroid and scales it to the unit disk.
+ *
+ * Produces the coordinates of every shape pixel relative to the centroid, divided by the
+ * largest centroid distance, and (if enabled) the shape resampled with the nearest pixel on
+ * the fixed canvas.
+ *
+ * @param buffers The thread's buffers, whose mask holds the binarized image.
+ * @param width The image width.
+ * @param height The image height.
+ * @param callback Called with the normalized shape.
+ * @param index The index passed to the callback.
+ */
+void ShapePreprocessor::normalize(Buffers &buffers, int width, int height, const Callback &callback, size_t index) const
+{
+    NormalizedShape shape;
+    shape.width = width;
+    shape.height = height;
+    shape.mask = buffers.mask.data();
+
+    // Centroid and area
+    ShapeFrame &frame = shape.frame;
+    for (int y = 0; y < height; ++y)
+    {
+        const unsigned char *row = &buffers.mask[static_cast<size_t>(y) * width];
+        for (int x = 0; x < width; ++x)
+        {
+            if (row[x])
+            {
+                frame.centroidX += x;
+                frame.centroidY += y;
+                ++frame.area;
+            }
+        }
+    }
+    if (frame.area == 0)
+    {
+        throw std::runtime_error("Image contains no shape pixels");
+    }
+    frame.centroidX /= frame.area;
+    frame.centroidY /= frame.area;
+
+    // Shape pixels relative to the centroid
+    buffers.unitX.resize(frame.area);
+    buffers.unitY.resize(frame.area);
+    size_t point = 0;
+    double maxSquared = 0.0;
+    for (int y = 0; y < height; ++y)
+    {
+        const unsigned char *row = &buffers.mask[static_cast<size_t>(y) * width];
+        for (int x = 0; x < width; ++x)
+        {
+            if (row[x])
+            {
+                double dx = x - frame.centroidX;
+                double dy = y - frame.centroidY;
+                buffers.unitX[point] = dx;
+                buffers.unitY[point] = dy;
+                maxSquared = std::max(maxSquared, dx * dx + dy * dy);
+                ++point;
+            }
+        }
+    }
+    frame.maxRadius = std::sqrt(maxSquared);
+
+    // Scale to the unit disk
+    double inverseRadius = frame.maxRadius > 0 ? 1.0 / frame.maxRadius : 0.0;
+    for (size_t i = 0; i < frame.area; ++i)
+    {
+        buffers.unitX[i] *= inverseRadius;
+        buffers.unitY[i] *= inverseRadius;
+    }
+    shape.pointCount = frame.area;
+    shape.unitX = buffers.unitX.data();
+    shape.unitY = buffers.unitY.data();
+
+    // Resample on the fixed canvas
+    if (canvasSize > 0)
+    {
+        buffers.canvas.resize(static_cast<size_t>(canvasSize) * canvasSize);
+        double center = (canvasSize - 1) / 2.0;
+        double scale = frame.maxRadius / (canvasSize / 2.0); // Source pixels per canvas pixel
+        for (int v = 0; v < canvasSize; ++v)
+        {
+            int y = static_cast<int>(std::lround(frame.centroidY + (v - center) * scale));
+            for (int u = 0; u < canvasSize; ++u)
+            {
+                int x = static_cast<int>(std::lround(frame.centroidX + (u - center) * scale));
+                bool inside = x >= 0 && x < width && y >= 0 && y < height;
+                buffers.canvas[static_cast<size_t>(v) * canvasSize + u] =
+                    inside && buffers.mask[static_cast<size_t>(y) * width + x];
+            }
+        }
+        shape.canvasSize = canvasSize;
+        shape.canvas = buffers.canvas.data();
+    }
+
+    callback(index, shape);
+}
@@ -0,0 +1,164 @@
+#include "../include/ZernikeExtractor.h"
+#include <cmath>
+
+namespace
+{
+    constexpr int zernikeSize = ZernikeExtractor::maxOrder + 1;
+    constexpr int zernikeLanes = 4;              // Pixels accumulated side by side
+    constexpr double zernikeReferenceMass = 20000.0; // Shapes are rescaled to this mass (in pixels)
+
+    constexpr double factorial(int n)
+    {
+        double result = 1.0;
+        for (int i = 2; i <= n; ++i)
+        {
+            result *= i;
+        }
+        return result;
+    }
+
+    // coefficient[n][m][p] is the coefficient of rho^p in the radial polynomial R_nm(rho)
+    struct RadialTable
+    {
+        double coefficient[zernikeSize][zernikeSize][zernikeSize];
+    };
+
+    constexpr RadialTable makeRadialTable()
+    {
+        RadialTable table{};
+        for (int n = 0; n < zernikeSize; ++n)
+        {
+            for (int m = n % 2; m <= n; m += 2)
+            {
+                for (int k = 0; k <= (n - m) / 2; ++k)
+                {
+                    double sign = (k % 2 == 0) ? 1.0 : -1.0;
+                    table.coefficient[n][m][n - 2 * k] =
+                        sign * factorial(n - k) / (factorial(k) * factorial((n + m) / 2 - k) * factorial((n - m) / 2 - k));
+                }
+            }
+        }
+        return table;
+    }
+
+    constexpr RadialTable radialTable = makeRadialTable();
+}
+
+/**
+ * @brief Computes the Zernike moment magnitudes of a shape image.
+ *
+ * @param image The shape image.
+ * @return The 18 moment magnitudes.
+ */
+std::vector<double> ZernikeExtractor::compute(const PGMImage &image) const
+{
+    std::vector<double> descriptor;
+    preprocessor.processImage(image, [&](size_t, const NormalizedShape &shape)
+                              { descriptor = compute(shape); });
+    return descriptor;
+}
+
+/**
+ * @brief Computes the Zernike moment magnitudes of a normalized shape.
+ *
+ * The shape pixels are already centred on the centroid and mapped into the unit disk. Since
+ * R_nm is a polynomial, every moment is a linear combination of the sums
+ * S(p, m) = sum over shape pixels of rho^p * exp(-i m theta); these sums are accumulated in a
+ * single pass over the pixels (several pixels at a time, in independent lanes), and the
+ * moments are then assembled from the precomputed radial coefficient table.
+ *
+ * Magnitudes are scaled by (n + 1) / pi and normalized to a reference mass, which reproduces
+ * the scale of the shipped .zrk.txt files (up to the resampling of the original tool).
+ *
+ * @param shape The normalized shape.
+ * @return The 18 moment magnitudes.
+ */
+std::vector<double> ZernikeExtractor::compute(const NormalizedShape &shape) const
+{
+    size_t count = shape.pointCount;
+
+    // Accumulate S(p, m) lane by lane
+    double sumRe[zernikeSize][zernikeSize][zernikeLanes] = {};
+    double sumIm[zernikeSize][zernikeSize][zernikeLanes] = {};
+    for (size_t base = 0; base < count; base += zernikeLanes)
+    {
+        double power[zernikeSize][zernikeLanes];
+        double cosM[zernikeSize][zernikeLanes];
+        double sinM[zernikeSize][zernikeLanes];
+        double r[zernikeLanes], c[zernikeLanes], s[zernikeLanes];
+
+        for (int l = 0; l < zernikeLanes; ++l)
+        {
+            size_t i = base + l;
+            bool valid = i < count;
+            double x = valid ? shape.unitX[i] : 0.0;
+            double y = valid ? shape.unitY[i] : 0.0;
+            r[l] = std::sqrt(x * x + y * y);
+            c[l] = r[l] > 0 ? x / r[l] : 1.0;
+            s[l] = r[l] > 0 ? y / r[l] : 0.0;
+            power[0][l] = valid ? 1.0 : 0.0; // Padding lanes carry no weight
+            cosM[0][l] = 1.0;
+            sinM[0][l] = 0.0;
+        }
+        for (int k = 1; k < zernikeSize; ++k)
+        {
+            for (int l = 0; l < zernikeLanes; ++l)
+            {
+                power[k][l] = power[k - 1][l] * r[l];
+                cosM[k][l] = cosM[k - 1][l] * c[l] - sinM[k - 1][l] * s[l];
+                sinM[k][l] = sinM[k - 1][l] * c[l] + cosM[k - 1][l] * s[l];
+            }
+        }
+
+        for (int m = 0; m < zernikeSize; ++m)
+        {
+            for (int p = m; p < zernikeSize; p += 2)
+            {
+                for (int l = 0; l < zernikeLanes; ++l)
+                {
+                    sumRe[p][m][l] += power[p][l] * cosM[m][l];
+                    sumIm[p][m][l] -= power[p][l] * sinM[m][l];
+                }
+            }
+        }
+    }
+
+    // Assemble the moments from the radial coefficients
+    double massScale = zernikeReferenceMass / count;
+    std::vector<double> descriptor;
+    descriptor.reserve(momentCount);
+    for (int n = 2; n <= maxOrder; ++n)
+    {
+        for (int m = n % 2; m <= n; m += 2)
+        {
+            double re = 0.0, im = 0.0;
+            for (int p = m; p <= n; p += 2)
+            {
+                double coefficient = radialTable.coefficient[n][m][p];
+                for (int l = 0; l < zernikeLanes; ++l)
+                {
+                    re += coefficient * sumRe[p][m][l];
+                    im += coefficient * sumIm[p][m][l];
+                }
+            }
+            descriptor.push_back((n + 1) / M_PI * std::sqrt(re * re + im * im) * massScale);
+        }
+    }
+    return descriptor;
+}
+
+/**
+ * @brief Computes the descriptor of every image of a corpus directory.
+ *
+ * Images are decoded, normalized and projected in parallel, one image per task.
+ *
+ * @param corpusPath The directory holding the "sXXnYYY.pgm" images.
+ * @param sourceNames If not null, receives the file name of each returned sample.
+ * @return One DataPoint per image, labelled with its class number.
+ */
+std::vector<DataPoint> ZernikeExtractor::extractCorpus(const std::string &corpusPath,
+                                                       std::vector<std::string> *sourceNames) const
+{
+    return preprocessor.featurizeCorpus(corpusPath, [this](const NormalizedShape &shape)
+                                        { return compute(shape); }, sourceNames);
+}
@@ -1,5 +1,7 @@
 #include "../include/ClassifierEvaluation.h"
-#include "../include/DataPoint.h"
+#include "../include/FeatureMatrix.h"
+#include "../include/NeighborIndex.h"
+#include "../include/Parallel.h"
 #include <iostream>
 #include <iomanip>
 #include <random>
@@ -11,6 +13,7 @@
 #include <numeric>
 #include <filesystem>
 #include <vector>
+#include <chrono>
 
 /**
  * @brief Split the given data into training and test sets based on the given ratio.
@@ -26,31 +29,32 @@
  * @param stratified Whether to use stratification or standard random splitting.
  * @param minTestSamplesPerClass The minimum number of test samples required for each class
  * when using stratification.
- * @return A pair consisting of the training set and the test set.
+ * @return A pair consisting of the training set and the test set, as views of data (which
+ * must outlive them).
  */
-std::pair<std::vector<DataPoint>, std::vector<DataPoint>>
-ClassifierEvaluation::splitTrainTest(const std::vector<DataPoint> &data, double trainRatio, bool stratified, int minTestSamplesPerClass)
+std::pair<FeatureView, FeatureView>
+ClassifierEvaluation::splitTrainTest(const FeatureMatrix &data, double trainRatio, bool stratified, int minTestSamplesPerClass)
 {
-    std::vector<DataPoint> trainData;
-    std::vector<DataPoint> testData;
+    std::vector<size_t> trainIndices;
+    std::vector<size_t> testIndices;
     std::random_device rd;
     std::mt19937 gen(rd());
 
     // Stratification
     if (stratified)
     {
-        std::map<int, std::vector<DataPoint>> classMap;
+        std::map<int, std::vector<size_t>> classMap;
 
-        // Group data by class
-        for (const auto &point : data)
+        // Group row indices by class
+        for (size_t i = 0; i < data.size(); ++i)
         {
-            classMap[point.label].push_back(point);
+            classMap[data.label(i)].push_back(i);
         }
 
         for (auto &entry : classMap)
         {
             int label = entry.first;
-            std::vector<DataPoint> &classSamples = entry.second;
+            std::vector<size_t> &classSamples = entry.second;
 
             // Shuffle the data for this class
             std::shuffle(classSamples.begin(), classSamples.end(), gen);
@@ -67,8 +71,8 @@ ClassifierEvaluation::splitTrainTest(const std::vector<DataPoint> &data, double
                 continue;
             }
 
-            trainData.insert(trainData.end(), classSamples.begin(), classSamples.begin() + trainSize);
-            testData.insert(testData.end(), classSamples.begin() + trainSize, classSamples.end());
+            trainIndices.insert(trainIndices.end(), classSamples.begin(), classSamples.begin() + trainSize);
+            testIndices.insert(testIndices.end(), classSamples.begin() + trainSize, classSamples.end());
 
             // Debugging class-wise split
             std::cout << "Class " << label << ": Total = " << classSamples.size()
@@ -78,14 +82,15 @@ ClassifierEvaluation::splitTrainTest(const std::vector<DataPoint> &data, double
     else
     {
         // Standard random split
-        std::vector<DataPoint> shuffledData = data;
-        std::shuffle(shuffledData.begin(), shuffledData.end(), gen);
-        size_t trainSize = static_cast<size_t>(shuffledData.size() * trainRatio);
-        trainData.assign(shuffledData.begin(), shuffledData.begin() + trainSize);
-        testData.assign(shuffledData.begin() + trainSize, shuffledData.end());
+        std::vector<size_t> shuffledIndices(data.size());
+        std::iota(shuffledIndices.begin(), shuffledIndices.end(), 0);
+        std::shuffle(shuffledIndices.begin(), shuffledIndices.end(), gen);
+        size_t trainSize = static_cast<size_t>(shuffledIndices.size() * trainRatio);
+        trainIndices.assign(shuffledIndices.begin(), shuffledIndices.begin() + trainSize);
+        testIndices.assign(shuffledIndices.begin() + trainSize, shuffledIndices.end());
     }
 
-    return {trainData, testData};
+    return {FeatureView(data, std::move(trainIndices)), FeatureView(data, std::move(testIndices))};
 }
 
 /**
@@ -94,8 +99,12 @@ ClassifierEvaluation::splitTrainTest(const std::vector<DataPoint> &data, double
  * This function will split the provided data into k folds, and for each fold, it will train
  * the classifier on the k-1 remaining folds and test it on the remaining fold. The accuracy
  * of the classifier will be calculated for each fold and the average accuracy across all folds
- * will be printed to the console. The precision-recall curve for the classifier will also be
- * generated and saved to a CSV file.
+ * will be printed to the console, with the average time of one prediction. The precision-recall
+ * curve for the classifier will also be generated and saved to a CSV file.
+ *
+ * Folds are views of data: each fold only stores the positions of its samples. A classifier
+ * that needs normalized features is expected to be a Pipeline, which fits its scaler on the
+ * training folds only.
  *
  * @param classifier The classifier to evaluate.
  * @param data The data to use for the evaluation.
@@ -106,31 +115,29 @@ ClassifierEvaluation::splitTrainTest(const std::vector<DataPoint> &data, double
 template <typename Classifier>
 void ClassifierEvaluation::KFoldCrossValidation(
     Classifier &classifier,
-    const std::vector<DataPoint> &data,
+    const FeatureView &data,
     int k,
     const std::string &name,
     const std::string &datasetName)
 {
-    // Create a non-const copy of the data vector
-    std::vector<DataPoint> dataCopy = data;
-
-    // Initialize the folds
-    std::vector<std::vector<DataPoint>> folds(k);
-
     // Initialize the random number generator
     std::random_device rd;
     std::mt19937 gen(rd());
 
-    // Shuffle the data (using the non-const copy)
-    std::shuffle(dataCopy.begin(), dataCopy.end(), gen);
+    // Shuffle the positions of the samples
+    std::vector<size_t> order(data.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), gen);
 
-    // Split the data into k folds
-    for (size_t i = 0; i < dataCopy.size(); ++i)
+    // Split the positions into k folds
+    std::vector<std::vector<size_t>> folds(k);
+    for (size_t i = 0; i < order.size(); ++i)
     {
-        folds[i % k].push_back(dataCopy[i]);
+        folds[i % k].push_back(order[i]);
     }
 
     double totalAccuracy = 0;
+    std::chrono::duration<double, std::micro> predictionTime(0);
 
     // Variables to store the scores and labels for AUC and Precision-Recall
     std::vector<double> allScores;
@@ -139,37 +146,48 @@ void ClassifierEvaluation::KFoldCrossValidation(
     // For each fold, train on k-1 folds and test on the remaining fold
     for (int i = 0; i < k; ++i)
     {
-        std::vector<DataPoint> trainData;
-        std::vector<DataPoint> testData = folds[i];
+        std::vector<size_t> trainIndices;
 
         // Combine all the other folds for the training data
         for (int j = 0; j < k; ++j)
         {
             if (i != j)
             {
-                trainData.insert(trainData.end(), folds[j].begin(), folds[j].end());
+                trainIndices.insert(trainIndices.end(), folds[j].begin(), folds[j].end());
             }
         }
+        FeatureView trainData = data.subset(trainIndices);
+        FeatureView testData = data.subset(folds[i]);
 
         // Train the classifier
         classifier.train(trainData);
 
-        // Test the classifier on the test data for this fold
-        for (const auto &point : testData)
+        // Test the classifier on the test data for this fold: one prediction per sample gives
+        // both the label counted in the accuracy and the score used for the curves
+        int correctPredictions = 0;
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::pair<int, double>> predictions = predictAll(classifier, testData);
+        predictionTime += std::chrono::steady_clock::now() - start;
+        for (size_t p = 0; p < predictions.size(); ++p)
         {
-            auto [predictedLabel, score] = classifier.predictWithScore(point);
+            auto [predictedLabel, score] = predictions[p];
             allScores.push_back(score);
-            allTrueLabels.push_back(point.label);
+            allTrueLabels.push_back(testData.label(p));
+            correctPredictions += predictedLabel == testData.label(p);
         }
 
         // Calculate the accuracy for this fold
-        double foldAccuracy = computeAccuracy(classifier, testData);
+        double foldAccuracy = testData.empty() ? 0.0 : 100.0 * correctPredictions / testData.size();
         totalAccuracy += foldAccuracy;
     }
 
     // Calculate the average accuracy
     double averageAccuracy = totalAccuracy / k;
     std::cout << "Average Accuracy across " << k << " folds: " << averageAccuracy << "%\n";
+    if (!allScores.empty())
+    {
+        std::cout << "Average prediction time: " << predictionTime.count() / allScores.size() << " us\n";
+    }
 
     // Generate the precision-recall curve and save it to a CSV file
     computePrecisionRecallCurve(
@@ -182,6 +200,128 @@ void ClassifierEvaluation::KFoldCrossValidation(
     std::cout << "AUC: " << auc << "\n";
 }
 
+/**
+ * @brief Computes the leave-one-out accuracy of KNN for a whole range of K in one pass.
+ *
+ * The squared distances between all pairs of samples are computed once, over the upper
+ * triangle only (in parallel, pairing short and long rows so that every task does the same
+ * work), and mirrored. Each sample then sorts its maxK nearest other samples once; growing K
+ * adds one neighbour to the vote, so every K is scored from the same sorted row. The vote is
+ * the one of KNNClassifier: inverse-distance weights, ties on the distance broken by the
+ * position of the sample and ties on the vote by the smaller label. The matrix holds n^2
+ * distances.
+ *
+ * @param data The samples, already normalized.
+ * @param maxK The largest number of neighbours evaluated (capped at n - 1).
+ * @return The accuracy in percent for K = 1 to maxK (element K - 1).
+ */
+std::vector<double> ClassifierEvaluation::leaveOneOutKSweep(const FeatureView &data, int maxK)
+{
+    if (data.size() < 2 || maxK < 1)
+    {
+        return {};
+    }
+
+    FeatureView samples = data.sorted(); // Same neighbour order as a trained KNNClassifier
+    size_t n = samples.size();
+    size_t dimension = samples.dimension();
+    size_t kMax = std::min(static_cast<size_t>(maxK), n - 1);
+
+    // Upper triangle, mirrored: rows i and n - 1 - i form one task of n - 1 distances
+    std::vector<Accum> distances(n * n, 0.0);
+    parallelFor((n + 1) / 2, [&](size_t task)
+                {
+                    size_t rows[2] = {task, n - 1 - task};
+                    size_t rowCount = rows[0] == rows[1] ? 1 : 2; // Middle row of an odd count
+                    for (size_t r = 0; r < rowCount; ++r)
+                    {
+                        size_t i = rows[r];
+                        FeatureRow row = samples.row(i);
+                        for (size_t j = i + 1; j < n; ++j)
+                        {
+                            Accum distance = squaredEuclidean(row, samples.data(j), dimension);
+                            distances[i * n + j] = distance;
+                            distances[j * n + i] = distance;
+                        }
+                    } });
+
+    // Whether each sample is classified correctly, for each K
+    std::vector<std::vector<char>> hitsPerSample(n);
+    parallelFor(n, [&](size_t i)
+                {
+                    std::vector<Neighbor> neighbors;
+                    neighbors.reserve(n - 1);
+                    for (size_t j = 0; j < n; ++j)
+                    {
+                        if (j != i)
+                        {
+                            neighbors.emplace_back(distances[i * n + j], j);
+                        }
+                    }
+                    std::partial_sort(neighbors.begin(), neighbors.begin() + kMax, neighbors.end());
+
+                    // Weighted votes grow by one neighbour per K; only the label that gained
+                    // weight can take the lead
+                    std::map<int, double> votes;
+                    int leader = 0;
+                    double leaderVote = 0.0;
+                    std::vector<char> &hits = hitsPerSample[i];
+                    hits.assign(kMax, 0);
+                    for (size_t k = 0; k < kMax; ++k)
+                    {
+                        int label = samples.label(neighbors[k].second);
+                        double &vote = votes[label];
+                        vote += 1.0 / (std::sqrt(neighbors[k].first) + 1e-6);
+                        if (k == 0 || vote > leaderVote || (vote == leaderVote && label < leader))
+                        {
+                            leader = label;
+                            leaderVote = vote;
+                        }
+                        hits[k] = leader == samples.label(i);
+                    } });
+
+    std::vector<double> accuracy(kMax);
+    for (size_t k = 0; k < kMax; ++k)
+    {
+        size_t hits = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            hits += hitsPerSample[i][k];
+        }
+        accuracy[k] = 100.0 * hits / n;
+    }
+    return accuracy;
+}
+
+/**
+ * @brief Predicts the label and the score of every sample of a test set.
+ *
+ * Classifiers with a batch path (predictBatch) score the whole set in one call; the others
+ * are called once per sample.
+ *
+ * @param classifier The trained classifier.
+ * @param testData The test data.
+ * @return One (label, score) pair per test sample, in order.
+ */
+template <typename Classifier>
+std::vector<std::pair<int, double>> ClassifierEvaluation::predictAll(const Classifier &classifier, const FeatureView &testData)
+{
+    if constexpr (HasBatchPrediction<Classifier>::value)
+    {
+        return classifier.predictBatch(testData);
+    }
+    else
+    {
+        std::vector<std::pair<int, double>> predictions;
+        predictions.reserve(testData.size());
+        for (const FeatureRow point : testData)
+        {
+            predictions.push_back(classifier.predictWithScore(point));
+        }
+        return predictions;
+    }
+}
+
 /**
  * @brief Compute the accuracy of a classifier on a given test dataset.
  *
@@ -194,12 +334,12 @@ void ClassifierEvaluation::KFoldCrossValidation(
  * @return The accuracy of the classifier as a percentage.
  */
 template <typename Classifier>
-double ClassifierEvaluation::computeAccuracy(Classifier &classifier, const std::vector<DataPoint> &testData)
+double ClassifierEvaluation::computeAccuracy(Classifier &classifier, const FeatureView &testData)
 {
     int correctPredictions = 0;
     int totalPredictions = 0;
 
-    for (const auto &point : testData)
+    for (const FeatureRow point : testData)
     {
         try
         {
@@ -243,25 +383,24 @@ double ClassifierEvaluation::computeAccuracy(Classifier &classifier, const std::
  * @param augmentationFraction The fraction of the data to be augmented.
  * @return The augmented data.
  */
-std::vector<DataPoint> ClassifierEvaluation::augmentNoise(
-    const std::vector<DataPoint> &data, double noiseLevel, double augmentationFraction)
+FeatureMatrix ClassifierEvaluation::augmentNoise(
+    const FeatureView &data, double noiseLevel, double augmentationFraction)
 {
 
-    std::vector<DataPoint> augmentedData = data; // Copy the original data
+    FeatureMatrix augmentedData = data.materialize(); // Copy the original data
 
     int numAugmented = static_cast<int>(data.size() * augmentationFraction);
+    augmentedData.reserve(data.size() + numAugmented);
 
     for (int i = 0; i < numAugmented; ++i)
     {
-        const auto &point = data[i % data.size()];
-        DataPoint noisyPoint = point;
+        augmentedData.append(data.row(i % data.size()));
+        Scalar *noisyFeatures = augmentedData.data(augmentedData.size() - 1);
 
-        for (auto &feature : noisyPoint.features)
+        for (size_t j = 0; j < augmentedData.dimension(); ++j)
         {
-            feature += (static_cast<double>(rand()) / RAND_MAX - 0.5) * 2 * noiseLevel;
+            noisyFeatures[j] += (static_cast<double>(rand()) / RAND_MAX - 0.5) * 2 * noiseLevel;
         }
-
-        augmentedData.push_back(noisyPoint);
     }
 
     std::cout << "Augmented data train size: " << augmentedData.size() << "\n";
@@ -276,13 +415,13 @@ std::vector<DataPoint> ClassifierEvaluation::augmentNoise(
  * are displayed in the form of a confusion matrix and overall accuracy.
  * Additionally, per-class precision, recall, and F1-score are computed and
  * displayed. Finally, macro precision, recall, and F1-score are computed and
- * displayed.
+ * displayed, along with the average time taken by one prediction.
  *
  * @param classifier The classifier to be tested.
  * @param testData The test data to evaluate the classifier on.
  */
 template <typename Classifier>
-void ClassifierEvaluation::testAndDisplayResults(Classifier &classifier, const std::vector<DataPoint> &testData)
+void ClassifierEvaluation::testAndDisplayResults(Classifier &classifier, const FeatureView &testData)
 {
     if (testData.empty())
     {
@@ -290,15 +429,11 @@ void ClassifierEvaluation::testAndDisplayResults(Classifier &classifier, const s
         return;
     }
 
-    // Determine the number of classes (from 1 to 10)
-    int numClasses = 10;
-
-    // Normalize data
-    std::vector<DataPoint> normalizedTestData = classifier.normalizeData(testData);
-    if (normalizedTestData.size() != testData.size())
+    // Determine the number of classes (labels run from 1 to the largest test label)
+    int numClasses = 0;
+    for (size_t i = 0; i < testData.size(); ++i)
     {
-        std::cerr << "Warning: Normalized test data size (" << normalizedTestData.size()
-                  << ") does not match original test data size (" << testData.size() << ").\n";
+        numClasses = std::max(numClasses, testData.label(i));
     }
 
     // Initialize confusion matrix
@@ -306,16 +441,17 @@ void ClassifierEvaluation::testAndDisplayResults(Classifier &classifier, const s
     int totalPoints = 0;
     int correctAssignments = 0;
 
-    for (const auto &point : normalizedTestData)
+    auto start = std::chrono::steady_clock::now();
+    for (const FeatureRow point : testData)
     {
         try
         {
             int predictedLabel = classifier.predict(point);
             int actualLabel = point.label;
 
-            if (actualLabel >= 1 && actualLabel <= numClasses && // Updated to check from 1 to 10
+            if (actualLabel >= 1 && actualLabel <= numClasses &&
                 predictedLabel >= 1 && predictedLabel <= numClasses)
-            {                                                           // Updated to check from 1 to 10
+            {
                 confusionMatrix[actualLabel - 1][predictedLabel - 1]++; // Adjust indexing to start from 0
                 if (predictedLabel == actualLabel)
                 {
@@ -336,6 +472,8 @@ void ClassifierEvaluation::testAndDisplayResults(Classifier &classifier, const s
         }
     }
 
+    std::chrono::duration<double, std::micro> predictionTime = std::chrono::steady_clock::now() - start;
+
     if (totalPoints != testData.size())
     {
         std::cerr << "Processed " << totalPoints << " out of " << testData.size() << " samples.\n";
@@ -347,6 +485,7 @@ void ClassifierEvaluation::testAndDisplayResults(Classifier &classifier, const s
     // Calculate overall accuracy
     double accuracy = totalPoints > 0 ? (static_cast<double>(correctAssignments) / totalPoints) * 100 : 0;
     std::cout << "\nAccuracy: " << accuracy << "%\n";
+    std::cout << "Average prediction time: " << predictionTime.count() / testData.size() << " us\n";
 
     // Per-class metrics
     double totalPrecision = 0, totalRecall = 0, totalF1 = 0;
@@ -513,17 +652,17 @@ void ClassifierEvaluation::computePrecisionRecallCurve(
 template <typename Classifier>
 void ClassifierEvaluation::evaluateWithPrecisionRecall(
     const Classifier &classifier,
-    const std::vector<DataPoint> &testData,
+    const FeatureView &testData,
     const std::string &outputCsvPath)
 {
     std::vector<double> scores;
     std::vector<int> trueLabels;
 
-    for (const auto &point : testData)
+    std::vector<std::pair<int, double>> predictions = predictAll(classifier, testData);
+    for (size_t p = 0; p < predictions.size(); ++p)
     {
-        auto [predictedLabel, score] = classifier.predictWithScore(point);
-        scores.push_back(score);
-        trueLabels.push_back(point.label);
+        scores.push_back(predictions[p].second);
+        trueLabels.push_back(testData.label(p));
     }
 
     // Call to compute Precision-Recall curve and save it to a CSV
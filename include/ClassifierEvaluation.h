@@ -8,7 +8,21 @@
 #include <string>
 #include <fstream>
 #include <filesystem> // For directory management
-#include "DataPoint.h"
+#include <type_traits>
+#include <utility>
+#include "FeatureMatrix.h"
+
+// Whether a classifier can score a whole test set at once (predictBatch)
+template <typename Classifier, typename = void>
+struct HasBatchPrediction : std::false_type
+{
+};
+
+template <typename Classifier>
+struct HasBatchPrediction<Classifier, std::void_t<decltype(std::declval<const Classifier &>().predictBatch(std::declval<const FeatureView &>()))>>
+    : std::true_type
+{
+};
 
 class ClassifierEvaluation
 {
@@ -17,20 +31,20 @@ public:
     template <typename Classifier>
     void KFoldCrossValidation(
     Classifier &classifier, 
-    const std::vector<DataPoint> &data, 
+    const FeatureView &data, 
     int k, 
     const std::string &name, 
     const std::string &datasetName);
     // Function to add noise to the data
-    static std::vector<DataPoint> augmentNoise(const std::vector<DataPoint> &data, double noiseLevel, double augmentationFraction);
+    static FeatureMatrix augmentNoise(const FeatureView &data, double noiseLevel, double augmentationFraction);
 
-    // Function to split the data into training and test sets
-    static std::pair<std::vector<DataPoint>, std::vector<DataPoint>> splitTrainTest(
-        const std::vector<DataPoint> &data, double trainRatio = 0.7, bool stratified = true, int minTestSamplesPerClass = 3);
+    // Function to split the data into training and test sets (views over data, nothing is copied)
+    static std::pair<FeatureView, FeatureView> splitTrainTest(
+        const FeatureMatrix &data, double trainRatio = 0.7, bool stratified = true, int minTestSamplesPerClass = 3);
 
     // Function to test and display results
     template <typename Classifier>
-    static void testAndDisplayResults(Classifier &classifier, const std::vector<DataPoint> &testData);
+    static void testAndDisplayResults(Classifier &classifier, const FeatureView &testData);
 
     // Function to compute the precision-recall curve
     void computePrecisionRecallCurve(
@@ -43,14 +57,23 @@ public:
     template <typename Classifier>
     void evaluateWithPrecisionRecall(
         const Classifier &classifier,
-        const std::vector<DataPoint> &testData,
+        const FeatureView &testData,
         const std::string &outputCsvPath);
 
+    // Leave-one-out accuracy (%) of the KNN vote for every K from 1 to maxK, from one pairwise
+    // distance matrix: element K - 1 is the accuracy with K neighbours. The features must
+    // already be normalized as the classifier would see them.
+    static std::vector<double> leaveOneOutKSweep(const FeatureView &data, int maxK);
+
     // Private function to calculate accuracy
     template <typename Classifier>
-    static double computeAccuracy(Classifier &classifier, const std::vector<DataPoint> &testData);
+    static double computeAccuracy(Classifier &classifier, const FeatureView &testData);
 
 private:
+    // Label and score of every test sample, through predictBatch when the classifier has it
+    template <typename Classifier>
+    static std::vector<std::pair<int, double>> predictAll(const Classifier &classifier, const FeatureView &testData);
+
     // Private function to display the confusion matrix
     static void displayConfusionMatrix(const std::vector<std::vector<int>> &matrix);
     double computeAUC(const std::vector<int> &trueLabels, const std::vector<double> &scores);
@@ -0,0 +1,37 @@
+#ifndef DATASETREGISTRY_H
+#define DATASETREGISTRY_H
+
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "FeatureMatrix.h"
+
+// Process-wide cache of descriptor families, loaded lazily and concurrently
+class DatasetRegistry
+{
+public:
+    using Loader = std::function<FeatureMatrix(const std::string &method)>;
+
+    explicit DatasetRegistry(Loader loader);
+
+    // Starts loading the given families in the background (one task per family not yet requested)
+    void prefetch(const std::vector<std::string> &methods);
+
+    // Returns a family, loading it on first request; blocks until it is available
+    const FeatureMatrix &get(const std::string &method);
+
+    // Drops every cached family (the next request reloads from disk)
+    void clear();
+
+private:
+    std::shared_future<FeatureMatrix> request(const std::string &method);
+
+    Loader loader;
+    std::mutex mutex;
+    std::map<std::string, std::shared_future<FeatureMatrix>> datasets;
+};
+
+#endif // DATASETREGISTRY_H
@@ -0,0 +1,63 @@
+#ifndef DISTANCEKERNELS_H
+#define DISTANCEKERNELS_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "FeatureMatrix.h"
+
+// Instruction sets of the row kernels below, narrowest first. The widest one the CPU supports
+// is selected at the first call (CPUID); builds for other architectures always use Portable.
+enum class SimdLevel
+{
+    Portable, // Independent lane sums in plain C++
+    SSE2,     // 128-bit vectors
+    AVX2,     // 256-bit vectors with fused multiply-add
+    AVX512    // 512-bit vectors with fused multiply-add and masked tails
+};
+
+SimdLevel detectSimdLevel(); // Widest level supported by the CPU
+SimdLevel activeSimdLevel(); // Level used by the kernels
+// Forces a narrower level (e.g. to compare them); not thread-safe, call it before any search.
+// Returns the level actually selected, clamped to the detected one.
+SimdLevel setSimdLevel(SimdLevel level);
+SimdLevel parseSimdLevel(const std::string &name);
+std::string simdLevelName(SimdLevel level);
+
+// Kernels over two contiguous rows of dimension values. Vector widths only change the order of
+// the additions, so every caller in one run sees the same rounding. With float storage and
+// double accumulation the portable kernels are used whatever the level.
+Accum squaredL2(const Scalar *a, const Scalar *b, size_t dimension);
+Accum manhattanL1(const Scalar *a, const Scalar *b, size_t dimension);
+Accum dotProduct(const Scalar *a, const Scalar *b, size_t dimension);
+
+// Descriptor lengths with kernels compiled for their exact size (E34, Zernike7, Yang, ART, GFD)
+inline constexpr size_t specializedDimensions[] = {16, 18, 29, 36, 100};
+
+// squaredL2 for rows of a given dimension, selected once (e.g. when a classifier is trained) so
+// the scan calls it directly: the unrolled kernel of a specialized dimension, or the generic one.
+// The dimension argument must still be passed. Like setSimdLevel, a later level change does not
+// update pointers already taken.
+using RowKernel = Accum (*)(const Scalar *a, const Scalar *b, size_t dimension);
+RowKernel squaredL2Kernel(size_t dimension);
+RowKernel genericSquaredL2Kernel(); // The generic one, whatever the dimension (for comparisons)
+
+// Row with contiguous values: a FeatureRow is returned as is, any other accessor (e.g. a
+// scaler-bound row) is read once into a buffer of the calling thread, valid until the next
+// call on that thread
+inline FeatureRow contiguousRow(const FeatureRow &row) { return row; }
+template <typename Row>
+FeatureRow contiguousRow(const Row &row);
+
+// Squared Euclidean norm of each row of a view
+std::vector<Accum> squaredNorms(const FeatureView &rows);
+
+// Squared distances between two blocks of rows, through ||a||^2 + ||b||^2 - 2 a.b:
+// out[i * outStride + j] is the distance between a[aBegin + i] and b[bBegin + j].
+// Both views must have the same dimension; the zero padding of the rows is included in the
+// dot products, so the inner loop has no remainder. Negative rounding results are clamped to 0.
+void squaredDistanceBlock(const FeatureView &a, size_t aBegin, size_t aEnd, const Accum *aNorms,
+                          const FeatureView &b, size_t bBegin, size_t bEnd, const Accum *bNorms,
+                          Accum *out, size_t outStride);
+
+#endif // DISTANCEKERNELS_H
@@ -0,0 +1,180 @@
+#ifndef FEATUREMATRIX_H
+#define FEATUREMATRIX_H
+
+#include <cstddef>
+#include <iterator>
+#include <new>
+#include <vector>
+#include "DataPoint.h"
+#include "Scalar.h"
+
+class FeatureStore;
+
+// Allocator returning storage aligned to Alignment bytes (used for the feature block)
+template <typename T, size_t Alignment>
+struct AlignedAllocator
+{
+    using value_type = T;
+
+    template <typename U>
+    struct rebind
+    {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment> &) {}
+
+    T *allocate(size_t count)
+    {
+        return static_cast<T *>(::operator new(count * sizeof(T), std::align_val_t(Alignment)));
+    }
+
+    void deallocate(T *pointer, size_t)
+    {
+        ::operator delete(pointer, std::align_val_t(Alignment));
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment> &) const { return true; }
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment> &) const { return false; }
+};
+
+// Read-only view of one sample of a FeatureMatrix: its features and its label
+struct FeatureRow
+{
+    const Scalar *values = nullptr;
+    size_t dimension = 0;
+    int label = 0;
+
+    FeatureRow() = default;
+    FeatureRow(const Scalar *values, size_t dimension, int label) : values(values), dimension(dimension), label(label) {}
+
+    size_t size() const { return dimension; }
+    Scalar operator[](size_t index) const { return values[index]; }
+    const Scalar *begin() const { return values; }
+    const Scalar *end() const { return values + dimension; }
+};
+
+// Forward iterator over the rows of a FeatureMatrix or FeatureView, yielding FeatureRow views
+template <typename Rows>
+class RowIterator
+{
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = FeatureRow;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = FeatureRow;
+
+    RowIterator(const Rows *rows, size_t position) : rows(rows), position(position) {}
+
+    FeatureRow operator*() const { return rows->row(position); }
+    RowIterator &operator++()
+    {
+        ++position;
+        return *this;
+    }
+    bool operator==(const RowIterator &other) const { return position == other.position; }
+    bool operator!=(const RowIterator &other) const { return position != other.position; }
+
+private:
+    const Rows *rows;
+    size_t position;
+};
+
+// Row-major dataset of Scalar values stored in one 64-byte aligned block, with a parallel label array.
+// Every row starts on a 64-byte boundary; the padding after the last feature is kept at zero.
+class FeatureMatrix
+{
+public:
+    static constexpr size_t alignment = 64;
+
+    using const_iterator = RowIterator<FeatureMatrix>;
+
+    FeatureMatrix() = default;
+    FeatureMatrix(size_t rows, size_t dimension);
+    explicit FeatureMatrix(const std::vector<DataPoint> &points);
+    explicit FeatureMatrix(const FeatureStore &store);
+
+    size_t size() const { return labels.size(); }
+    bool empty() const { return labels.empty(); }
+    size_t dimension() const { return featureCount; }
+    size_t stride() const { return rowStride; }
+
+    const Scalar *data(size_t index) const { return values.data() + index * rowStride; }
+    Scalar *data(size_t index) { return values.data() + index * rowStride; }
+    int label(size_t index) const { return labels[index]; }
+    void setLabel(size_t index, int label) { labels[index] = label; }
+    FeatureRow row(size_t index) const { return FeatureRow(data(index), featureCount, labels[index]); }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, size()); }
+
+    // Appends a copy of a sample (the first sample appended to an empty matrix sets the dimension)
+    void append(const FeatureRow &row);
+    void append(const DataPoint &point);
+    void reserve(size_t rows);
+
+    // New matrix holding the given rows, in the given order
+    FeatureMatrix gather(const std::vector<size_t> &indices) const;
+
+    std::vector<DataPoint> toDataPoints() const;
+
+private:
+    void setDimension(size_t dimension);
+    template <typename T>
+    void appendValues(const T *source, size_t dimension, int label);
+
+    size_t featureCount = 0;
+    size_t rowStride = 0; // Scalars between the starts of consecutive rows
+    std::vector<Scalar, AlignedAllocator<Scalar, alignment>> values;
+    std::vector<int> labels;
+};
+
+// Selection of rows of a FeatureMatrix, by index: splits and folds share the features of the
+// original dataset instead of copying them. The matrix must outlive the view.
+class FeatureView
+{
+public:
+    using const_iterator = RowIterator<FeatureView>;
+
+    FeatureView() = default;
+    FeatureView(const FeatureMatrix &matrix); // Every row, in order
+    FeatureView(const FeatureMatrix &matrix, std::vector<size_t> indices);
+
+    size_t size() const { return indices.size(); }
+    bool empty() const { return indices.empty(); }
+    size_t dimension() const { return source ? source->dimension() : 0; }
+
+    const Scalar *data(size_t position) const { return source->data(indices[position]); }
+    int label(size_t position) const { return source->label(indices[position]); }
+    FeatureRow row(size_t position) const { return source->row(indices[position]); }
+
+    // Row of the underlying matrix at the given position of the view
+    size_t index(size_t position) const { return indices[position]; }
+    const FeatureMatrix &matrix() const { return *source; }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, size()); }
+
+    // Adds a row of the underlying matrix at the end of the view (e.g. one just appended to it)
+    void appendIndex(size_t index) { indices.push_back(index); }
+
+    // View of some positions of this view (over the same matrix)
+    FeatureView subset(const std::vector<size_t> &positions) const;
+
+    // Same rows, reordered by matrix index so that scans read the matrix sequentially
+    FeatureView sorted() const;
+
+    // Copies the selected rows into a new contiguous matrix
+    FeatureMatrix materialize() const { return source ? source->gather(indices) : FeatureMatrix(); }
+
+private:
+    const FeatureMatrix *source = nullptr;
+    std::vector<size_t> indices;
+};
+
+#endif // FEATUREMATRIX_H
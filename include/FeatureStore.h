@@ -0,0 +1,94 @@
+#ifndef FEATURESTORE_H
+#define FEATURESTORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "DataPoint.h"
+
+// Summary of the descriptor files of a method directory, recorded in a packed store so that
+// a store older than its directory can be detected
+struct SourceFingerprint
+{
+    uint64_t files = 0;       // Number of descriptor files (hidden files such as .DS_Store excluded)
+    uint64_t bytes = 0;       // Their total size
+    int64_t newestWrite = 0;  // Latest modification time among them (file clock ticks; 0 without file)
+
+    bool operator==(const SourceFingerprint &other) const
+    {
+        return files == other.files && bytes == other.bytes && newestWrite == other.newestWrite;
+    }
+    bool operator!=(const SourceFingerprint &other) const { return !(*this == other); }
+};
+
+// On-disk header of a packed feature store (80 bytes, native endianness)
+struct FeatureStoreHeader
+{
+    char magic[8];          // "SSFSTORE"
+    uint32_t version;       // Format version
+    uint32_t dimension;     // Number of features per row
+    uint64_t count;         // Number of rows
+    uint64_t stride;        // Row stride in doubles (padded to a 64-byte multiple)
+    uint64_t labelsOffset;  // Byte offset of the int32 label array
+    uint64_t namesOffset;   // Byte offset of the (count + 1) uint64 name offsets, followed by the name blob
+    uint64_t dataOffset;    // Byte offset of the 64-byte aligned row-major feature block
+    uint64_t sourceFiles;   // Fingerprint of the directory the store was packed from
+    uint64_t sourceBytes;
+    int64_t sourceNewestWrite;
+};
+
+// Read-only, memory-mapped view of a packed =Signatures/=<Method> directory
+class FeatureStore
+{
+public:
+    static constexpr size_t alignment = 64;
+
+    FeatureStore() = default;
+    explicit FeatureStore(const std::string &path);
+    ~FeatureStore();
+
+    FeatureStore(const FeatureStore &) = delete;
+    FeatureStore &operator=(const FeatureStore &) = delete;
+    FeatureStore(FeatureStore &&other) noexcept;
+    FeatureStore &operator=(FeatureStore &&other) noexcept;
+
+    // Packs the given samples (and the name of the file each one came from) into a store file,
+    // with the fingerprint of their directory
+    static void write(const std::string &path,
+                      const std::vector<DataPoint> &points,
+                      const std::vector<std::string> &sourceNames,
+                      const SourceFingerprint &source);
+
+    // Counts, sizes and dates the descriptor files of a directory (without reading them)
+    static SourceFingerprint fingerprint(const std::string &directory);
+
+    void open(const std::string &path);
+    void close();
+    bool isOpen() const { return mapping != nullptr; }
+
+    size_t size() const { return header ? header->count : 0; }
+    size_t dimension() const { return header ? header->dimension : 0; }
+    size_t stride() const { return header ? header->stride : 0; }
+    SourceFingerprint source() const; // Directory the store was packed from, as it was then
+
+    // Zero-copy access to the mapped rows
+    const double *row(size_t index) const { return data + index * header->stride; }
+    int label(size_t index) const { return labels[index]; }
+    std::string_view sourceName(size_t index) const;
+
+    // Copies the mapped rows into the DataPoint representation used by the classifiers
+    std::vector<DataPoint> toDataPoints() const;
+
+private:
+    void *mapping = nullptr;
+    size_t mappingSize = 0;
+    const FeatureStoreHeader *header = nullptr;
+    const int32_t *labels = nullptr;
+    const uint64_t *nameOffsets = nullptr;
+    const char *names = nullptr;
+    const double *data = nullptr;
+};
+
+#endif // FEATURESTORE_H
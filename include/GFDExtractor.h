@@ -0,0 +1,31 @@
+#ifndef GFDEXTRACTOR_H
+#define GFDEXTRACTOR_H
+
+#include <string>
+#include <vector>
+#include "DataPoint.h"
+#include "PGMImage.h"
+#include "ShapePreprocessor.h"
+
+// Computes the Generic Fourier Descriptor (=GFD) of shape images, as in the .gfd files: the
+// polar Fourier transform of Zhang & Lu summed over the shape pixels, around the centroid
+// truncated to whole pixels and scaled by the largest distance from it to a shape pixel
+class GFDExtractor
+{
+public:
+    static constexpr int radialFrequencies = 10;
+    static constexpr int angularFrequencies = 10;
+
+    // Descriptor of one image, in the same order as the .gfd files (radial-major, 100 values)
+    std::vector<double> compute(const PGMImage &image) const;
+    std::vector<double> compute(const NormalizedShape &shape) const;
+
+    // Featurizes every "sXXnYYY.pgm" of a corpus directory in parallel
+    std::vector<DataPoint> extractCorpus(const std::string &corpusPath,
+                                         std::vector<std::string> *sourceNames = nullptr) const;
+
+private:
+    ShapePreprocessor preprocessor;
+};
+
+#endif // GFDEXTRACTOR_H
@@ -0,0 +1,51 @@
+#ifndef IVFINDEX_H
+#define IVFINDEX_H
+
+#include <cstddef>
+#include <vector>
+#include "DistanceKernels.h"
+#include "FeatureMatrix.h"
+#include "NeighborIndex.h"
+
+// Settings of an inverted-file index
+struct IVFParameters
+{
+    size_t lists = 0;            // k-means clusters (0: square root of the number of samples)
+    size_t nprobe = 4;           // Lists scanned by a query, nearest centroid first
+    int trainingIterations = 25; // Largest number of k-means iterations
+    unsigned seed = 2024;        // Seed of the k-means++ draws, so the lists are reproducible
+};
+
+// Inverted-file index (IVF): KMeansClassifier partitions the samples into one list per
+// centroid. A query ranks the centroids and scans only the samples of its nprobe nearest
+// lists, with exact distances; recall grows with nprobe, up to the exact neighbours when every
+// list is probed.
+class IVFIndex
+{
+public:
+    void build(const FeatureView &data, const IVFParameters &settings = IVFParameters());
+    bool empty() const { return indexedCount == 0; }
+
+    // Files one more sample, at a given position, in the list of its nearest centroid; false
+    // when the index has no centroid yet
+    bool add(const FeatureRow &sample, size_t position);
+
+    const IVFParameters &parameters() const { return settings; }
+    void setNprobe(size_t nprobe) { settings.nprobe = nprobe; }
+    size_t listCount() const { return centroids.size(); }
+
+    template <typename Row>
+    void search(const Row &query, NeighborHeap &heap) const;
+
+private:
+    IVFParameters settings;
+    size_t nearestList(const Scalar *values) const;
+
+    FeatureMatrix centroids;                     // One row per list
+    std::vector<FeatureMatrix> lists;            // Indexed samples of each list
+    std::vector<std::vector<size_t>> positions;  // Position in the indexed view of each row of a list
+    size_t indexedCount = 0;
+    RowKernel distanceKernel = squaredL2; // Selected for the dimension
+};
+
+#endif // IVFINDEX_H
@@ -2,33 +2,50 @@
 #define KMEANSCLASSIFIER_H
 
 #include <vector>
+#include <random>
 #include <utility>
-#include "DataPoint.h"
+#include "DistanceKernels.h"
+#include "FeatureMatrix.h"
+#include "Scaler.h"
 #include <map>
 
 class KMeansClassifier
 {
 public:
+    using Scaler = StandardScaler; // Normalization expected on the features
+
     KMeansClassifier(int k, int maxIterations, double convergenceThreshold = 1e-4);
 
     std::map<int, int> clusterToLabel;
 
-    void train(const std::vector<DataPoint> &rawData);
-    int predict(const DataPoint &point);
-    void test(const std::vector<DataPoint> &testData, std::vector<int> &predictions);
-    std::pair<int, double> predictWithScore(const DataPoint &point) const;
-    std::vector<DataPoint> normalizeData(const std::vector<DataPoint> &rawData);
-    void mapClusterToLabels(const std::vector<DataPoint> &data);
+    void train(const FeatureView &rawData);
+    void test(const FeatureView &testData, std::vector<int> &predictions);
+
+    // Row is FeatureRow or any accessor with size(), operator[] and label (e.g. a scaler-bound row)
+    template <typename Row>
+    int predict(const Row &point) const;
+    template <typename Row>
+    std::pair<int, double> predictWithScore(const Row &point) const;
+    void mapClusterToLabels(const FeatureView &data);
+
+    // Lloyd iterations only (no label mapping, no output), with the k-means++ draws seeded by
+    // seed so that the clusters are reproducible; returns the iteration count
+    int cluster(const FeatureView &data, unsigned seed);
+
+    // Centroids found by cluster() or train(), one row per cluster, and the cluster of a point
+    // (e.g. for partitioning samples, as the IVF index does)
+    const FeatureMatrix &clusterCenters() const { return centroids; }
+    template <typename Row>
+    int getClosestCentroid(const Row &point, Accum *squaredDistance = nullptr) const;
 
 private:
     int k;
     int maxIterations;
     double convergenceThreshold;
-    std::vector<std::vector<double>> centroids;
+    FeatureMatrix centroids; // One row per cluster
+    RowKernel distanceKernel = squaredL2; // Selected for the training dimension
 
-    double computeDistance(const std::vector<double> &a, const std::vector<double> &b) const;
-    int getClosestCentroid(const DataPoint &point) const;
-    void initializeCentroids(const std::vector<DataPoint> &data);
+    void initializeCentroids(const FeatureView &data, std::mt19937 &generator);
 };
 
 #endif // KMEANSCLASSIFIER_H
@@ -1,27 +1,141 @@
 #ifndef KNNCLASSIFIER_H
 #define KNNCLASSIFIER_H
 
-#include "DataPoint.h"
+#include "DistanceKernels.h"
+#include "FeatureMatrix.h"
+#include "IVFIndex.h"
+#include "NeighborIndex.h"
+#include "PrototypeSelection.h"
+#include "QuantizedStore.h"
+#include "Scaler.h"
+#include <chrono>
+#include <memory>
 #include <vector>
 #include <cmath>
 #include <algorithm>
 
+// Outcome of one KNN search
+struct KNNPrediction
+{
+    int label = 0;      // Label with the largest inverse-distance weighted vote
+    double vote = 0.0;  // Its share of the total weight of the k neighbours (0..1)
+    double score = 0.0; // Negated sum of the distances to the k neighbours
+};
+
+// Limits of an anytime search (zero: no limit of that kind)
+struct SearchBudget
+{
+    std::chrono::microseconds time{0}; // Wall-clock time of the scan
+    size_t candidates = 0;             // Training samples compared with the query
+};
+
+// Outcome of an anytime search: the vote of the best neighbours found within the budget
+struct AnytimePrediction
+{
+    KNNPrediction prediction;
+    bool completed = false; // Every training sample was compared (same result as classify())
+    size_t scanned = 0;     // Live training samples compared
+};
+
 class KNNClassifier
 {
 private:
-    std::vector<DataPoint> trainingData;
+    FeatureView trainingData; // Refers to the training matrix, which must outlive the predictions
+    std::unique_ptr<FeatureMatrix> ownedSamples; // Copy of the references, made by the first add() or compaction
     int k; // Neighborhood size
+    NeighborIndexType requestedIndex; // Index asked for (may be Auto)
+    NeighborIndexType activeIndex = NeighborIndexType::BruteForce; // Index built by train()
+    KDTree kdTree;
+    BallTree ballTree;
+    HNSWIndex hnsw;
+    HNSWParameters hnswSettings; // Used when the index is HNSW
+    Int8Store int8Store;
+    ProductQuantizer productQuantizer;
+    QuantizationParameters quantizationSettings; // Used by the compressed stores
+    EarlyAbandonScan earlyAbandon;
+    IVFIndex ivf;
+    IVFParameters ivfSettings; // Used when the index is IVF
+    PrototypeSelection prototypes; // Reduction of the training samples kept as references
+    std::vector<size_t> anytimeOrder; // Scan order of classifyWithin(): labels in turn, central samples first
+    std::vector<Accum> trainingNorms; // Squared norm of each training sample, for batches
+    RowKernel distanceKernel = squaredL2; // Selected for the training dimension, for the scan
+
+    // Incremental updates: each position of trainingData has a stable id; removed positions are
+    // tombstoned until a compaction drops them, and positions from indexedCount on were added
+    // after a non-incremental index was built and are scanned by brute force
+    std::vector<size_t> ids;          // Id of each position
+    std::vector<size_t> positionOfId; // Position of each id (npos once removed)
+    std::vector<char> removed;        // Tombstone of each position
+    size_t removedCount = 0;
+    size_t indexedCount = 0;          // Positions covered by the index
 
 public:
-    explicit KNNClassifier(int k = 3) : k(k) {}
+    using Scaler = StandardScaler; // Normalization expected on the features
 
-    void train(const std::vector<DataPoint> &data);
-    int predict(const DataPoint &testPoint) const;
-    static std::vector<DataPoint> normalizeData(const std::vector<DataPoint> &data);
-    std::pair<int, double> predictWithScore(const DataPoint &testPoint) const;
+    explicit KNNClassifier(int k = 3, NeighborIndexType index = NeighborIndexType::BruteForce,
+                           const HNSWParameters &hnswSettings = HNSWParameters(),
+                           const QuantizationParameters &quantizationSettings = QuantizationParameters(),
+                           const IVFParameters &ivfSettings = IVFParameters(),
+                           PrototypeSelection prototypes = PrototypeSelection::None);
+
+    // Stores the training data (reduced to its prototypes, if a selection was requested) and
+    // builds the requested index over it
+    void train(const FeatureView &data);
+
+    // Row is FeatureRow or any accessor with size(), operator[] and label (e.g. a scaler-bound row)
+    template <typename Row>
+    KNNPrediction classify(const Row &testPoint) const; // Label, vote and score in one search
+    template <typename Row>
+    int predict(const Row &testPoint) const;
+    template <typename Row>
+    std::pair<int, double> predictWithScore(const Row &testPoint) const;
+
+    // Anytime prediction for a latency budget: scans the training samples in anytimeOrder until
+    // the budget runs out and votes with the best neighbours found so far (exact when completed;
+    // the index is not used)
+    template <typename Row>
+    AnytimePrediction classifyWithin(const Row &testPoint, const SearchBudget &budget) const;
+
+    // Whole test sets, already normalized like the training data: the distances are computed
+    // by blocks of queries x training samples (brute force for every exact index; approximate
+    // indexes are searched for each query instead)
+    std::vector<KNNPrediction> classifyBatch(const FeatureView &testData) const;
+    std::vector<std::pair<int, double>> predictBatch(const FeatureView &testData) const;
+
+    // Incremental updates of the references (not thread-safe with predictions). Training
+    // samples have the id of their position in the view given to train(); add() returns the id
+    // of a new sample, normalized like the training data, which the HNSW graph, the IVF lists
+    // and the compressed stores (int8, pq: existing ranges and codebooks) index at once, at a
+    // cost independent of the number of references.
+    // The KD-tree, ball tree and early-abandon indexes are not incremental: they scan new
+    // samples by brute force until the next compaction rebuilds them. remove() tombstones a
+    // sample (false if the id is unknown). Compaction drops the tombstones and rebuilds (and
+    // retrains) the index; it runs by itself once a quarter of the references are removed or
+    // unindexed.
+    size_t add(const FeatureRow &sample);
+    bool remove(size_t id);
+    void compact();
+
+    // Pushes the k nearest training samples, as (squared distance, position in trainingData),
+    // into a heap reset to k; ties go to the smaller position, whatever the index
+    template <typename Row>
+    void searchNeighbors(const Row &testPoint, NeighborHeap &heap) const;
+
+    NeighborIndexType index() const { return activeIndex; }
+    size_t referenceCount() const { return trainingData.size() - removedCount; } // Live reference samples
 
 private:
-    double calculateDistance(const DataPoint &a, const DataPoint &b) const;
+    // Fills anytimeOrder from the training data
+    void buildAnytimeOrder();
+
+    // Recomputes the norms, the kernel and the anytime order of trainingData (no tombstone),
+    // and builds the active index over it
+    void prepareReferences();
+    void buildIndex();
+    void compactIfNeeded();
+
+    // Weighted vote and score of neighbours given as (squared distance, position), nearest first
+    KNNPrediction tally(const std::vector<Neighbor> &neighbors) const;
 };
 
 #endif // KNNCLASSIFIER_H
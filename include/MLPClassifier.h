@@ -3,31 +3,39 @@
 #include <stdexcept>
 #include <iostream>
 #include <random>
-#include "DataPoint.h"
+#include "FeatureMatrix.h"
+#include "Scaler.h"
 
 class MLPClassifier
 {
 public:
+    using Scaler = SampleStandardScaler; // Normalization expected on the features
+
     MLPClassifier(int inputSize, int hiddenSize, int outputSize);
-    void train(const std::vector<DataPoint> &trainingData, int epochs = 1000, double learningRate = 0.01);
-    std::pair<int, double> predictWithScore(const DataPoint &point) const;
-    std::vector<DataPoint> normalizeData(const std::vector<DataPoint> &data) const;
-    int predict(const DataPoint &point) const;
-    std::vector<double> softmax(const std::vector<double> &logits) const;
+    void train(const FeatureView &trainingData, int epochs = 1000, double learningRate = 0.01);
+
+    // Row is FeatureRow or any accessor with size(), operator[] and label (e.g. a scaler-bound row)
+    template <typename Row>
+    std::pair<int, double> predictWithScore(const Row &point) const;
+    template <typename Row>
+    int predict(const Row &point) const;
+
+    std::vector<Scalar> softmax(const std::vector<Scalar> &logits) const;
 
 private:
     int inputSize;
     int hiddenSize;
     int outputSize;
 
-    std::vector<std::vector<double>> weightsInputHidden;
-    std::vector<double> biasHidden;
-    std::vector<std::vector<double>> weightsHiddenOutput;
-    std::vector<double> biasOutput;
+    std::vector<std::vector<Scalar>> weightsInputHidden;
+    std::vector<Scalar> biasHidden;
+    std::vector<std::vector<Scalar>> weightsHiddenOutput;
+    std::vector<Scalar> biasOutput;
 
     // Sigmoid activation function
-    double sigmoid(double x) const;
+    Scalar sigmoid(Accum x) const;
 
-    // Forward propagation
-    std::pair<std::vector<double>, std::vector<double>> forward(const std::vector<double> &input) const;
+    // Forward propagation (Input is a pointer to the features or a row accessor)
+    template <typename Input>
+    std::pair<std::vector<Scalar>, std::vector<Scalar>> forward(const Input &input) const;
 };
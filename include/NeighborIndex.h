@@ -0,0 +1,204 @@
+#ifndef NEIGHBORINDEX_H
+#define NEIGHBORINDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "DistanceKernels.h"
+#include "FeatureMatrix.h"
+
+// Search structure used by KNNClassifier to find the nearest training samples
+enum class NeighborIndexType
+{
+    BruteForce, // Scan every training sample
+    KDTree,     // Axis-aligned splits, best for low dimensions
+    BallTree,   // Nested hyperspheres, for the higher-dimensional descriptors
+    HNSW,       // Approximate: hierarchical navigable small world graph
+    Int8,       // Approximate: scan of byte-quantized samples, exact re-ranking of the best ones
+    ProductQuantized, // Approximate: scan of product-quantized samples, exact re-ranking
+    EarlyAbandon, // Scan that drops a sample once its partial distance exceeds the k-th best
+    IVF,        // Approximate: k-means lists, only the lists nearest to the query are scanned
+    Auto        // KD-tree up to kdTreeMaxDimension features, ball tree above (always exact)
+};
+
+constexpr size_t kdTreeMaxDimension = 20;
+
+NeighborIndexType parseNeighborIndexType(const std::string &name);
+std::string neighborIndexName(NeighborIndexType type);
+bool isApproximate(NeighborIndexType type); // May miss some of the exact neighbours
+
+// Candidate neighbour: squared Euclidean distance and position in the indexed view
+using Neighbor = std::pair<Accum, size_t>;
+
+// Squared Euclidean distance between a query and a stored sample, through the dispatched
+// squaredL2 kernel. Every search structure uses this function, so they all see the same
+// distances.
+template <typename Row>
+Accum squaredEuclidean(const Row &a, const Scalar *b, size_t dimension);
+
+// The k smallest (squared distance, position) pairs pushed so far. Ties on the distance are
+// broken by the smaller position, so every search returns the same neighbours.
+// The storage is kept across reset() calls, so a reused heap does not allocate.
+class NeighborHeap
+{
+public:
+    explicit NeighborHeap(size_t k = 0) { reset(k); }
+
+    // Empties the heap and sets the number of neighbours to keep
+    void reset(size_t count);
+
+    size_t capacity() const { return k; }
+    bool full() const { return heap.size() >= k; }
+    Accum worst() const; // k-th smallest distance so far (infinity while fewer than k)
+    void push(Accum squaredDistance, size_t position);
+
+    // Orders the kept neighbours nearest first; the heap must be reset before the next search
+    const std::vector<Neighbor> &sort();
+
+private:
+    size_t k;
+    std::vector<Neighbor> heap; // Max-heap on (distance, position)
+};
+
+// KD-tree over the samples of a view: each node splits its samples at the median of the
+// feature with the largest spread. Exact search.
+class KDTree
+{
+public:
+    void build(const FeatureView &data, size_t leafSize = 16);
+    bool empty() const { return nodes.empty(); }
+
+    template <typename Row>
+    void search(const Row &query, NeighborHeap &heap) const;
+
+private:
+    struct Node
+    {
+        size_t begin, end; // Range of rows of points
+        int left = -1, right = -1;
+        size_t axis = 0;
+        Scalar split = 0; // Left rows have axis <= split, right rows have axis >= split
+    };
+
+    int buildNode(const FeatureView &data, size_t begin, size_t end, size_t leafSize);
+    template <typename Row>
+    void searchNode(int node, const Row &query, NeighborHeap &heap) const;
+
+    std::vector<Node> nodes;
+    FeatureMatrix points;          // Indexed samples, reordered so that each leaf is contiguous
+    std::vector<size_t> positions; // Position in the indexed view of each row of points
+};
+
+// Ball tree over the samples of a view: each node stores the centroid of its samples and the
+// radius of the ball around it that holds them all. Exact search.
+class BallTree
+{
+public:
+    void build(const FeatureView &data, size_t leafSize = 16);
+    bool empty() const { return nodes.empty(); }
+
+    template <typename Row>
+    void search(const Row &query, NeighborHeap &heap) const;
+
+private:
+    struct Node
+    {
+        size_t begin, end; // Range of rows of points
+        int left = -1, right = -1;
+        Accum radius = 0;
+    };
+
+    int buildNode(const FeatureView &data, size_t begin, size_t end, size_t leafSize);
+    template <typename Row>
+    void searchNode(int node, const Row &query, NeighborHeap &heap) const;
+    template <typename Row>
+    Accum lowerBound(int node, const Row &query) const; // Smallest possible distance to the ball
+
+    std::vector<Node> nodes;
+    FeatureMatrix centers;         // One row per node
+    FeatureMatrix points;          // Indexed samples, reordered so that each leaf is contiguous
+    std::vector<size_t> positions; // Position in the indexed view of each row of points
+};
+
+// Settings of an HNSW graph
+struct HNSWParameters
+{
+    size_t M = 16;               // Links per node on the upper layers (2M on the bottom layer)
+    size_t efConstruction = 200; // Candidates examined when linking a new node
+    size_t efSearch = 50;        // Candidates examined by a query (raised to k if smaller)
+};
+
+// Hierarchical navigable small world graph (Malkov & Yashunin): approximate search whose
+// recall grows with efSearch. Nodes are inserted in parallel on the shared thread pool.
+class HNSWIndex
+{
+public:
+    void build(const FeatureView &data, const HNSWParameters &settings = HNSWParameters());
+    bool empty() const { return levels.empty(); }
+
+    // Inserts one more sample as the next position (not thread-safe with searches)
+    void add(const FeatureRow &sample);
+
+    const HNSWParameters &parameters() const { return settings; }
+    void setEfSearch(size_t efSearch) { settings.efSearch = efSearch; }
+
+    template <typename Row>
+    void search(const Row &query, NeighborHeap &heap) const;
+
+private:
+    using Candidate = std::pair<Accum, uint32_t>; // (squared distance, node)
+
+    // Locks are null when a single node is inserted on its own
+    void insert(uint32_t node, std::vector<std::mutex> *locks, std::mutex *entryLock);
+    int drawLevel();
+    template <typename Row>
+    uint32_t greedyClosest(const Row &query, uint32_t entry, int layer, std::vector<std::mutex> *locks) const;
+    template <typename Row>
+    void searchLayer(const Row &query, uint32_t entry, size_t ef, int layer,
+                     std::vector<Candidate> &nearest, std::vector<std::mutex> *locks) const;
+    void selectNeighbors(std::vector<Candidate> &candidates, size_t count) const;
+
+    // Links of a node on a layer (locks, when given, are held during the copy or the update)
+    void copyLinks(uint32_t node, int layer, std::vector<uint32_t> &out, std::vector<std::mutex> *locks) const;
+    void setLinks(uint32_t node, int layer, const std::vector<Candidate> &selected);
+    size_t maxLinks(int layer) const { return layer == 0 ? 2 * settings.M : settings.M; }
+
+    HNSWParameters settings;
+    FeatureMatrix points;                // Node i is position i of the indexed view
+    std::vector<int> levels;             // Top layer of each node
+    std::vector<uint32_t> baseLinks;     // Bottom-layer links, 2M slots per node
+    std::vector<uint32_t> baseLinkCount; // Used slots of each node
+    std::vector<std::vector<std::vector<uint32_t>>> upperLinks; // [node][layer - 1]
+    uint32_t entryPoint = 0;
+    int maxLevel = -1;
+    std::mt19937 levelGenerator; // Seeded by build(), continued by add()
+};
+
+// Exact scan with early abandoning: a sample's squared distance is added up by blocks of
+// features and dropped as soon as the partial sum exceeds the current k-th best distance. The
+// samples are copied with their features sorted by decreasing variance, so the features that
+// separate samples most come first and the blocks read before abandoning are contiguous.
+// Samples that are not abandoned get their exact distance from the indexed view, so the
+// neighbours are those of a full scan.
+class EarlyAbandonScan
+{
+public:
+    // The view must outlive the scan (the survivors are re-scored from it)
+    void build(const FeatureView &data, bool orderByVariance = true);
+    bool empty() const { return points.empty(); }
+
+    template <typename Row>
+    void search(const Row &query, NeighborHeap &heap) const;
+
+private:
+    FeatureView reference;
+    FeatureMatrix points;              // Indexed samples, features in scan order (row i is position i)
+    std::vector<uint32_t> featureOrder; // Feature of the view stored in each column of points
+    RowKernel exactKernel = squaredL2;  // Selected for the dimension, for the survivors
+};
+
+#endif // NEIGHBORINDEX_H
@@ -0,0 +1,41 @@
+#ifndef PGMIMAGE_H
+#define PGMIMAGE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// A sample of the =Corpus/pgm directory
+struct CorpusEntry
+{
+    std::string name; // File name, e.g. "s01n001.pgm"
+    std::string path; // Full path
+    int label;        // Class number taken from the name
+};
+
+// Position and extent of the shape drawn in an image
+struct ShapeFrame
+{
+    double centroidX = 0.0;
+    double centroidY = 0.0;
+    double maxRadius = 0.0; // Largest distance from the centroid to a shape pixel
+    size_t area = 0;        // Number of shape pixels
+};
+
+// 8-bit grey-level image read from a PGM (P2 or P5) file
+struct PGMImage
+{
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> pixels; // Row-major, width * height values
+
+    // Shapes are drawn in black on a white background
+    bool isShape(int x, int y) const { return pixels[static_cast<size_t>(y) * width + x] < 128; }
+
+    static PGMImage read(const std::string &path);
+
+    // Lists the "sXXnYYY.pgm" files of a corpus directory, sorted by name
+    static std::vector<CorpusEntry> listCorpus(const std::string &directory);
+};
+
+#endif // PGMIMAGE_H
@@ -0,0 +1,164 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads running index loops; started once and reused by every batch
+class ThreadPool
+{
+public:
+    explicit ThreadPool(size_t threadCount = std::max(1u, std::thread::hardware_concurrency()))
+    {
+        for (size_t t = 1; t < threadCount; ++t) // The calling thread is the last worker
+        {
+            workers.emplace_back([this]()
+                                 { workerLoop(); });
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            stopping = true;
+        }
+        wakeUp.notify_all();
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    size_t size() const { return workers.size() + 1; }
+
+    // Runs body(i) for every i in [0, count) and returns when all are done.
+    // If the pool is already running a batch (e.g. a nested call), the loop runs on the caller.
+    void run(size_t count, const std::function<void(size_t)> &body)
+    {
+        std::unique_lock<std::mutex> batchLock(batchMutex, std::try_to_lock);
+        if (!batchLock.owns_lock() || workers.empty() || count <= 1)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                body(i);
+            }
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            job = &body;
+            jobCount = count;
+            next = 0;
+            error = nullptr;
+            busyWorkers = workers.size();
+            ++generation;
+        }
+        wakeUp.notify_all();
+
+        work(body, count);
+
+        std::unique_lock<std::mutex> lock(stateMutex);
+        finished.wait(lock, [this]()
+                      { return busyWorkers == 0; });
+        job = nullptr;
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+
+    // Pool shared by the whole process
+    static ThreadPool &shared()
+    {
+        static ThreadPool pool;
+        return pool;
+    }
+
+private:
+    void work(const std::function<void(size_t)> &body, size_t count)
+    {
+        try
+        {
+            for (size_t i = next++; i < count; i = next++)
+            {
+                body(i);
+            }
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            if (!error)
+            {
+                error = std::current_exception();
+            }
+            next = count; // Stop handing out work
+        }
+    }
+
+    void workerLoop()
+    {
+        size_t seenGeneration = 0;
+        while (true)
+        {
+            const std::function<void(size_t)> *body;
+            size_t count;
+            {
+                std::unique_lock<std::mutex> lock(stateMutex);
+                wakeUp.wait(lock, [&]()
+                            { return stopping || generation != seenGeneration; });
+                if (stopping)
+                {
+                    return;
+                }
+                seenGeneration = generation;
+                body = job;
+                count = jobCount;
+            }
+
+            work(*body, count);
+
+            std::lock_guard<std::mutex> lock(stateMutex);
+            if (--busyWorkers == 0)
+            {
+                finished.notify_one();
+            }
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::mutex batchMutex; // Held by the thread whose batch is running
+    std::mutex stateMutex;
+    std::condition_variable wakeUp;
+    std::condition_variable finished;
+    const std::function<void(size_t)> *job = nullptr;
+    size_t jobCount = 0;
+    std::atomic<size_t> next{0};
+    size_t busyWorkers = 0;
+    size_t generation = 0;
+    bool stopping = false;
+    std::exception_ptr error;
+};
+
+// Runs body(i) for every i in [0, count) on the shared thread pool.
+// Items are handed out one at a time, so uneven per-item costs balance out.
+// The first exception thrown by body is rethrown on the calling thread.
+template <typename Body>
+void parallelFor(size_t count, Body &&body)
+{
+    std::function<void(size_t)> task = std::forward<Body>(body);
+    ThreadPool::shared().run(count, task);
+}
+
+#endif // PARALLEL_H
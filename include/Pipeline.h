@@ -0,0 +1,51 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <utility>
+#include <vector>
+#include "FeatureMatrix.h"
+
+// Scaler and classifier bound together at compile time. train() fits the scaler on the raw
+// training data and trains the classifier on a normalized copy kept by the pipeline; single
+// queries are normalized on the fly (through Scaler::bind), so the test set is never copied:
+// a classifier reads each bound query once, into a per-thread buffer for its kernels.
+//
+// The classifier may keep a view of the pipeline's training matrix, so a pipeline can be
+// neither copied nor moved.
+template <typename Scaler, typename Classifier>
+class Pipeline
+{
+public:
+    // Forwards its arguments to the classifier's constructor
+    template <typename... Args>
+    explicit Pipeline(Args &&...args) : model(std::forward<Args>(args)...) {}
+
+    Pipeline(const Pipeline &) = delete;
+    Pipeline &operator=(const Pipeline &) = delete;
+
+    // Extra arguments (e.g. epochs) are forwarded to the classifier's train()
+    template <typename... Args>
+    void train(const FeatureView &data, Args &&...args);
+
+    // Take raw (unnormalized) samples
+    int predict(const FeatureRow &point) const;
+    std::pair<int, double> predictWithScore(const FeatureRow &point) const;
+
+    // Scores a whole raw test set through the classifier's batch path, normalizing it by blocks
+    // of batchBlockSize samples (only available when the classifier has predictBatch)
+    template <typename Model = Classifier>
+    auto predictBatch(const FeatureView &samples) const
+        -> decltype(std::declval<const Model &>().predictBatch(samples));
+
+    static constexpr size_t batchBlockSize = 1024;
+
+    const Scaler &scaler() const { return fittedScaler; }
+    const Classifier &classifier() const { return model; }
+
+private:
+    Scaler fittedScaler;
+    Classifier model;
+    FeatureMatrix trainingData; // Normalized training samples
+};
+
+#endif // PIPELINE_H
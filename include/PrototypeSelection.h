@@ -0,0 +1,28 @@
+#ifndef PROTOTYPESELECTION_H
+#define PROTOTYPESELECTION_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "FeatureMatrix.h"
+
+// Reduction of a KNN reference set to the samples that shape the decision boundary
+enum class PrototypeSelection
+{
+    None,           // Keep every training sample
+    Edited,         // Wilson's edited nearest neighbours: drop samples their k neighbours outvote
+    Condensed,      // Hart's condensed nearest neighbours: keep a subset that 1-NN classifies the rest with
+    EditedCondensed // Edit out the noisy samples first, then condense the rest
+};
+
+PrototypeSelection parsePrototypeSelection(const std::string &name);
+std::string prototypeSelectionName(PrototypeSelection selection);
+
+// Positions, in increasing order, of the samples of a view that a selection keeps; k is the
+// neighbourhood of the editing step. Both steps compare squared Euclidean distances, with ties
+// broken by position, and run their scans in parallel on the shared thread pool.
+std::vector<size_t> selectPrototypes(const FeatureView &data, PrototypeSelection selection, int k);
+std::vector<size_t> editedNearestNeighbours(const FeatureView &data, int k);
+std::vector<size_t> condensedNearestNeighbours(const FeatureView &data);
+
+#endif // PROTOTYPESELECTION_H
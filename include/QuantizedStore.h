@@ -0,0 +1,89 @@
+#ifndef QUANTIZEDSTORE_H
+#define QUANTIZEDSTORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "FeatureMatrix.h"
+#include "NeighborIndex.h"
+
+// Settings of the compressed reference stores
+struct QuantizationParameters
+{
+    size_t rerank = 32;          // Candidates of the compressed scan re-ranked with exact distances (at least k)
+    size_t subspaceWidth = 4;    // Product quantization: features per subspace
+    size_t centroids = 256;      // Product quantization: codewords per subspace (at most 256)
+    size_t trainingRounds = 12;  // Product quantization: k-means iterations per subspace
+};
+
+// Reference samples stored as one signed byte per feature: each feature is mapped linearly
+// from its training range onto [-127, 127]. The scan compares the query, kept in full
+// precision, with the codes (asymmetric distance); the best candidates are then re-ranked
+// with their exact distances, read from the indexed view.
+class Int8Store
+{
+public:
+    // The view must outlive the store (its samples are read by the re-ranking)
+    void build(const FeatureView &data, const QuantizationParameters &settings = QuantizationParameters());
+    bool empty() const { return count == 0; }
+    size_t memoryBytes() const; // Codes and per-feature ranges
+
+    // Encodes one more sample, at the next position, with the ranges of build() (values outside
+    // them are clamped); the sample must be row sourceIndex of the matrix the store reads
+    void add(const FeatureRow &sample, size_t sourceIndex);
+    // Re-ranks from another view holding the same samples at the same positions
+    void rebind(const FeatureView &data) { reference = data; }
+
+    template <typename Row>
+    void search(const Row &query, NeighborHeap &heap) const;
+
+private:
+    QuantizationParameters settings;
+    FeatureView reference;
+    size_t count = 0;
+    size_t dimension = 0;
+    size_t codeStride = 0;      // Bytes per sample (the dimension, padded for the scan)
+    std::vector<int8_t> codes;  // count x codeStride, row-major
+    std::vector<Accum> centers; // Middle of the training range of each feature
+    std::vector<Accum> steps;   // Value of one code unit of each feature
+    std::vector<float> weights; // Squared steps, for the scan (0 in the padding)
+
+    void encode(const Scalar *values, int8_t *code) const;
+};
+
+// Reference samples stored by product quantization: the features are cut into subspaces of
+// subspaceWidth features, each subspace has its own k-means codebook, and a sample is stored
+// as one codeword index (one byte) per subspace. A query first fills a table of its squared
+// distances to every codeword, so scanning a sample costs one lookup per subspace; the best
+// candidates are then re-ranked with their exact distances.
+class ProductQuantizer
+{
+public:
+    // The view must outlive the quantizer (its samples are read by the re-ranking)
+    void build(const FeatureView &data, const QuantizationParameters &settings = QuantizationParameters());
+    bool empty() const { return count == 0; }
+    size_t memoryBytes() const; // Codes and codebooks
+
+    // Encodes one more sample, at the next position, with the codebooks of build() (no
+    // retraining); the sample must be row sourceIndex of the matrix the quantizer reads
+    void add(const FeatureRow &sample, size_t sourceIndex);
+    // Re-ranks from another view holding the same samples at the same positions
+    void rebind(const FeatureView &data) { reference = data; }
+
+    template <typename Row>
+    void search(const Row &query, NeighborHeap &heap) const;
+
+private:
+    QuantizationParameters settings;
+    FeatureView reference;
+    size_t count = 0;
+    size_t dimension = 0;
+    size_t subspaceCount = 0;
+    size_t codewords = 0;                // Codewords per subspace
+    std::vector<size_t> subspaceBegin;   // First feature of each subspace, plus the dimension
+    std::vector<uint8_t> codes;          // count x subspaceCount, row-major
+    std::vector<Scalar> codebooks;       // Subspace s holds codewords x width values, at codebookOffset[s]
+    std::vector<size_t> codebookOffset;
+};
+
+#endif // QUANTIZEDSTORE_H
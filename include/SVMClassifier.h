@@ -2,24 +2,33 @@
 #define SVMCLASSIFIER_H
 
 #include <vector>
-#include "DataPoint.h"
+#include "FeatureMatrix.h"
+#include "Scaler.h"
 
 class SVMClassifier
 {
 private:
-    std::vector<double> weights; // SVM weights
-    double bias;                 // Bias
+    std::vector<Scalar> weights; // SVM weights
+    Scalar bias;                 // Bias
     double learningRate;         // Learning rate
     int maxIterations;           // Maximum number of iterations
 
 public:
+    using Scaler = L2Scaler; // Normalization expected on the features
+
     SVMClassifier(double learningRate = 0.01, int maxIterations = 1000);
 
-    void train(const std::vector<DataPoint> &trainingData);
-    int predict(const DataPoint &point) const;
+    void train(const FeatureView &trainingData);
+
+    // Row is FeatureRow or any accessor with size(), operator[] and label (e.g. a scaler-bound row)
+    template <typename Row>
+    int predict(const Row &point) const;
+    template <typename Row>
+    std::pair<int, double> predictWithScore(const Row &point) const;
 
-    std::vector<DataPoint> normalizeData(const std::vector<DataPoint> &data) const;
-    std::pair<int, double> predictWithScore(const DataPoint &point) const;
+private:
+    template <typename Row>
+    Accum decisionValue(const Row &point) const; // w.x + b
 };
 
 #endif // SVMCLASSIFIER_H
\ No newline at end of file
@@ -0,0 +1,20 @@
+#ifndef SCALAR_H
+#define SCALAR_H
+
+// Storage type of features, centroids and weights.
+// double by default; compile with -DUSE_FLOAT_SCALAR to halve the memory traffic of the scans.
+#ifdef USE_FLOAT_SCALAR
+using Scalar = float;
+#else
+using Scalar = double;
+#endif
+
+// Type used to accumulate sums, dot products and distances, chosen independently of Scalar.
+// double by default; compile with -DUSE_FLOAT_ACCUMULATOR to accumulate in float as well.
+#ifdef USE_FLOAT_ACCUMULATOR
+using Accum = float;
+#else
+using Accum = double;
+#endif
+
+#endif // SCALAR_H
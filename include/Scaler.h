@@ -0,0 +1,87 @@
+#ifndef SCALER_H
+#define SCALER_H
+
+#include <cstddef>
+#include <vector>
+#include "FeatureMatrix.h"
+
+// Sample normalized on the fly with per-feature statistics: feature i reads
+// (values[i] - center[i]) * scale[i]. Nothing is written back to memory.
+struct StandardizedRow
+{
+    const Scalar *values = nullptr;
+    const Scalar *center = nullptr;
+    const Scalar *scale = nullptr;
+    size_t dimension = 0;
+    int label = 0;
+
+    size_t size() const { return dimension; }
+    Scalar operator[](size_t index) const { return (values[index] - center[index]) * scale[index]; }
+};
+
+// Sample normalized on the fly with one shift and one factor for all its features:
+// feature i reads (values[i] - center) * scale
+struct AffineRow
+{
+    const Scalar *values = nullptr;
+    Scalar center = 0;
+    Scalar scale = 1;
+    size_t dimension = 0;
+    int label = 0;
+
+    size_t size() const { return dimension; }
+    Scalar operator[](size_t index) const { return (values[index] - center) * scale; }
+};
+
+// Feature-wise Z-score normalization. The per-feature mean and standard deviation are fitted
+// once on the training data, then applied unchanged to training, test and live samples.
+class StandardScaler
+{
+public:
+    using Row = StandardizedRow;
+
+    // Single-pass (Welford) estimate of the mean and standard deviation of each feature
+    void fit(const FeatureView &data);
+
+    // Normalizes the rows in place
+    void transform(FeatureMatrix &data) const;
+    void transform(Scalar *values, size_t dimension) const;
+
+    // Normalized accessor over a raw sample (the scaler must outlive it)
+    Row bind(const FeatureRow &row) const;
+
+    const std::vector<Scalar> &mean() const { return means; }
+    const std::vector<Scalar> &inverseStdDev() const { return inverseStdDevs; }
+
+private:
+    std::vector<Scalar> means;
+    std::vector<Scalar> inverseStdDevs; // 0 for constant features, which are mapped to 0
+};
+
+// Per-sample normalization to unit Euclidean norm (nothing to fit)
+class L2Scaler
+{
+public:
+    using Row = AffineRow;
+
+    void fit(const FeatureView &) {}
+
+    void transform(FeatureMatrix &data) const;
+    void transform(Scalar *values, size_t dimension) const;
+    Row bind(const FeatureRow &row) const;
+};
+
+// Per-sample Z-score normalization over the features of each sample (nothing to fit)
+class SampleStandardScaler
+{
+public:
+    using Row = AffineRow;
+
+    void fit(const FeatureView &) {}
+
+    void transform(FeatureMatrix &data) const;
+    void transform(Scalar *values, size_t dimension) const;
+    Row bind(const FeatureRow &row) const;
+};
+
+#endif // SCALER_H
@@ -0,0 +1,62 @@
+#ifndef SHAPEPREPROCESSOR_H
+#define SHAPEPREPROCESSOR_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+#include "DataPoint.h"
+#include "PGMImage.h"
+
+// A binarized shape, translated to its centroid and scaled to the unit disk.
+// The pointers refer to buffers owned by the preprocessing thread and are only valid during the callback.
+struct NormalizedShape
+{
+    ShapeFrame frame;                  // Centroid, radius and area in source pixels
+    int width = 0;                     // Source image size
+    int height = 0;
+    const unsigned char *mask = nullptr; // width * height values, 1 for shape pixels
+    size_t pointCount = 0;             // Number of shape pixels (frame.area)
+    const double *unitX = nullptr;     // (x - centroidX) / maxRadius of each shape pixel
+    const double *unitY = nullptr;     // (y - centroidY) / maxRadius of each shape pixel
+    int canvasSize = 0;                // Side of the fixed canvas (0 if disabled)
+    const unsigned char *canvas = nullptr; // canvasSize^2 values, the shape with its centroid at the centre
+                                       // and its largest centroid distance mapped to canvasSize / 2
+
+    bool isShape(int x, int y) const { return mask[static_cast<size_t>(y) * width + x] != 0; }
+};
+
+// Decodes PGM files and normalizes their shape, in parallel, without per-image allocation:
+// each pool thread keeps its decoding and normalization buffers from one image to the next
+class ShapePreprocessor
+{
+public:
+    using Callback = std::function<void(size_t index, const NormalizedShape &shape)>;
+
+    // canvasSize = 0 skips the resampling on a fixed canvas
+    explicit ShapePreprocessor(int canvasSize = 0) : canvasSize(canvasSize) {}
+
+    // Processes every file on the shared thread pool; callback runs on the worker thread
+    void processBatch(const std::vector<std::string> &paths, const Callback &callback) const;
+
+    // Processes one file on the calling thread
+    void processFile(const std::string &path, const Callback &callback, size_t index = 0) const;
+
+    // Processes an already decoded image on the calling thread
+    void processImage(const PGMImage &image, const Callback &callback) const;
+
+    // Runs a descriptor on every "sXXnYYY.pgm" of a corpus directory, labelling samples by class
+    std::vector<DataPoint> featurizeCorpus(const std::string &corpusPath,
+                                           const std::function<std::vector<double>(const NormalizedShape &)> &descriptor,
+                                           std::vector<std::string> *sourceNames = nullptr) const;
+
+private:
+    struct Buffers;
+    static Buffers &threadBuffers();
+
+    void normalize(Buffers &buffers, int width, int height, const Callback &callback, size_t index) const;
+
+    int canvasSize;
+};
+
+#endif // SHAPEPREPROCESSOR_H
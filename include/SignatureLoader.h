@@ -0,0 +1,24 @@
+#ifndef SIGNATURELOADER_H
+#define SIGNATURELOADER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "DataPoint.h"
+
+// Fast reader for the =Signatures/=<Method> descriptor directories
+class SignatureLoader
+{
+public:
+    // Loads every "sXXnYYY.*" file of a method directory, sorted by name, labelled with XX
+    static std::vector<DataPoint> loadDirectory(const std::string &methodPath,
+                                                std::vector<std::string> *sourceNames = nullptr);
+
+    // Extracts the class and sample numbers from a file name such as "s01n001.art"
+    static bool parseSampleName(std::string_view fileName, int &label, int &sample);
+
+    // Parses whitespace-separated numbers from a text buffer; returns false on malformed input
+    static bool parseValues(std::string_view text, std::vector<double> &values);
+};
+
+#endif // SIGNATURELOADER_H
@@ -0,0 +1,29 @@
+#ifndef ZERNIKEEXTRACTOR_H
+#define ZERNIKEEXTRACTOR_H
+
+#include <string>
+#include <vector>
+#include "DataPoint.h"
+#include "PGMImage.h"
+#include "ShapePreprocessor.h"
+
+// Computes the =Zernike7 descriptor (|A_nm| for 2 <= n <= 7, 0 <= m <= n, n - m even) from shape images
+class ZernikeExtractor
+{
+public:
+    static constexpr int maxOrder = 7;
+    static constexpr int momentCount = 18;
+
+    // Descriptor of one image, in the same order as the .zrk.txt files: (2,0), (2,2), (3,1), ...
+    std::vector<double> compute(const PGMImage &image) const;
+    std::vector<double> compute(const NormalizedShape &shape) const;
+
+    // Featurizes every "sXXnYYY.pgm" of a corpus directory in parallel
+    std::vector<DataPoint> extractCorpus(const std::string &corpusPath,
+                                         std::vector<std::string> *sourceNames = nullptr) const;
+
+private:
+    ShapePreprocessor preprocessor;
+};
+
+#endif // ZERNIKEEXTRACTOR_H
@@ -0,0 +1,76 @@
+#include "../include/DatasetRegistry.h"
+#include <utility>
+
+/**
+ * @brief Constructs a registry that reads families with the given loader.
+ *
+ * @param loader The function loading one descriptor family (e.g. "=ART") from disk.
+ */
+DatasetRegistry::DatasetRegistry(Loader loader) : loader(std::move(loader)) {}
+
+/**
+ * @brief Returns the pending or finished load of a family, starting it if needed.
+ *
+ * The first request of a family launches its loader on a separate thread; later requests
+ * share the same future, so each family is read from disk at most once.
+ *
+ * @param method The descriptor family to load.
+ * @return A shared future holding the family's data.
+ */
+std::shared_future<FeatureMatrix> DatasetRegistry::request(const std::string &method)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = datasets.find(method);
+    if (it == datasets.end())
+    {
+        std::shared_future<FeatureMatrix> future =
+            std::async(std::launch::async, loader, method).share();
+        it = datasets.emplace(method, std::move(future)).first;
+    }
+    return it->second;
+}
+
+/**
+ * @brief Starts loading several families concurrently without waiting for them.
+ *
+ * @param methods The descriptor families to load.
+ */
+void DatasetRegistry::prefetch(const std::vector<std::string> &methods)
+{
+    for (const auto &method : methods)
+    {
+        request(method);
+    }
+}
+
+/**
+ * @brief Returns the data of a family, waiting for its load to finish.
+ *
+ * The returned reference stays valid for the lifetime of the registry (or until clear()).
+ * Errors thrown by the loader are rethrown here.
+ *
+ * @param method The descriptor family to get.
+ * @return The family's data.
+ */
+const FeatureMatrix &DatasetRegistry::get(const std::string &method)
+{
+    std::shared_future<FeatureMatrix> future = request(method);
+    future.wait();
+
+    // The future stored in the map owns the shared state, so the reference outlives this copy
+    std::lock_guard<std::mutex> lock(mutex);
+    return datasets.at(method).get();
+}
+
+/**
+ * @brief Drops all cached families, waiting for pending loads first.
+ */
+void DatasetRegistry::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &entry : datasets)
+    {
+        entry.second.wait();
+    }
+    datasets.clear();
+}
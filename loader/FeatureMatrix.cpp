@@ -0,0 +1,224 @@
+#include "../include/FeatureMatrix.h"
+#include "../include/FeatureStore.h"
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @brief Constructs a zero-filled matrix.
+ *
+ * @param rows The number of samples.
+ * @param dimension The number of features per sample.
+ */
+FeatureMatrix::FeatureMatrix(size_t rows, size_t dimension)
+{
+    setDimension(dimension);
+    values.assign(rows * rowStride, 0.0);
+    labels.assign(rows, 0);
+}
+
+/**
+ * @brief Copies a dataset into a contiguous matrix.
+ *
+ * @param points The samples. All of them must have the same feature dimension.
+ */
+FeatureMatrix::FeatureMatrix(const std::vector<DataPoint> &points)
+{
+    reserve(points.size());
+    for (const auto &point : points)
+    {
+        append(point);
+    }
+}
+
+/**
+ * @brief Copies the rows of a packed feature store.
+ *
+ * With double scalars the store has the same 64-byte row stride, so its feature block is
+ * copied in one go; otherwise each row is converted to Scalar.
+ *
+ * @param store An open feature store.
+ */
+FeatureMatrix::FeatureMatrix(const FeatureStore &store)
+{
+    setDimension(store.dimension());
+    values.assign(store.size() * rowStride, Scalar(0));
+    if constexpr (std::is_same_v<Scalar, double>)
+    {
+        if (store.stride() != rowStride)
+        {
+            throw std::runtime_error("Feature store stride does not match the matrix layout.");
+        }
+        if (store.size() > 0)
+        {
+            std::memcpy(values.data(), store.row(0), values.size() * sizeof(double));
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < store.size(); ++i)
+        {
+            std::transform(store.row(i), store.row(i) + featureCount, data(i),
+                           [](double value)
+                           { return static_cast<Scalar>(value); });
+        }
+    }
+    labels.resize(store.size());
+    for (size_t i = 0; i < labels.size(); ++i)
+    {
+        labels[i] = store.label(i);
+    }
+}
+
+/**
+ * @brief Sets the feature dimension and the padded row stride.
+ *
+ * @param dimension The number of features per sample.
+ */
+void FeatureMatrix::setDimension(size_t dimension)
+{
+    size_t rowBytes = (dimension * sizeof(Scalar) + alignment - 1) / alignment * alignment;
+    featureCount = dimension;
+    rowStride = rowBytes / sizeof(Scalar);
+}
+
+/**
+ * @brief Reserves storage for a number of rows.
+ *
+ * @param rows The expected number of samples.
+ */
+void FeatureMatrix::reserve(size_t rows)
+{
+    values.reserve(rows * rowStride);
+    labels.reserve(rows);
+}
+
+/**
+ * @brief Appends a copy of a sample at the end of the matrix.
+ *
+ * @param row The sample to append. Its dimension must match the matrix (unless it is empty).
+ */
+void FeatureMatrix::append(const FeatureRow &row)
+{
+    appendValues(row.values, row.size(), row.label);
+}
+
+/**
+ * @brief Appends a copy of a sample, converting its features to Scalar.
+ *
+ * @param point The sample to append. Its dimension must match the matrix (unless it is empty).
+ */
+void FeatureMatrix::append(const DataPoint &point)
+{
+    appendValues(point.features.data(), point.features.size(), point.label);
+}
+
+/**
+ * @brief Appends a row of values of any arithmetic type.
+ *
+ * @param source The features of the sample.
+ * @param dimension The number of features.
+ * @param label The label of the sample.
+ */
+template <typename T>
+void FeatureMatrix::appendValues(const T *source, size_t dimension, int label)
+{
+    if (labels.empty() && values.empty())
+    {
+        setDimension(dimension);
+    }
+    if (dimension != featureCount)
+    {
+        throw std::invalid_argument("All rows of a feature matrix must have the same dimension.");
+    }
+
+    size_t offset = values.size();
+    values.resize(offset + rowStride, Scalar(0));
+    std::transform(source, source + dimension, values.begin() + offset,
+                   [](T value)
+                   { return static_cast<Scalar>(value); });
+    labels.push_back(label);
+}
+
+/**
+ * @brief Copies a subset of the rows into a new matrix.
+ *
+ * @param indices The rows to copy, in the order they should appear.
+ * @return The gathered matrix.
+ */
+FeatureMatrix FeatureMatrix::gather(const std::vector<size_t> &indices) const
+{
+    FeatureMatrix result(indices.size(), featureCount);
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        std::copy(data(indices[i]), data(indices[i]) + featureCount, result.data(i));
+        result.labels[i] = labels[indices[i]];
+    }
+    return result;
+}
+
+/**
+ * @brief Copies the rows back into the per-sample DataPoint representation.
+ *
+ * @return One DataPoint per row, with its label and unpadded features.
+ */
+std::vector<DataPoint> FeatureMatrix::toDataPoints() const
+{
+    std::vector<DataPoint> points(size());
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+        points[i].label = labels[i];
+        points[i].features.assign(data(i), data(i) + featureCount);
+    }
+    return points;
+}
+
+/**
+ * @brief Constructs a view of every row of a matrix.
+ *
+ * @param matrix The viewed matrix.
+ */
+FeatureView::FeatureView(const FeatureMatrix &matrix) : source(&matrix), indices(matrix.size())
+{
+    std::iota(indices.begin(), indices.end(), 0);
+}
+
+/**
+ * @brief Constructs a view of some rows of a matrix.
+ *
+ * @param matrix The viewed matrix.
+ * @param indices The selected rows, in view order (a row may appear several times).
+ */
+FeatureView::FeatureView(const FeatureMatrix &matrix, std::vector<size_t> indices)
+    : source(&matrix), indices(std::move(indices)) {}
+
+/**
+ * @brief Selects some positions of this view.
+ *
+ * @param positions Positions in this view (not matrix rows).
+ * @return A view over the same matrix.
+ */
+FeatureView FeatureView::subset(const std::vector<size_t> &positions) const
+{
+    std::vector<size_t> selected(positions.size());
+    for (size_t i = 0; i < positions.size(); ++i)
+    {
+        selected[i] = indices[positions[i]];
+    }
+    return FeatureView(*source, std::move(selected));
+}
+
+/**
+ * @brief Returns the same selection ordered by matrix row.
+ *
+ * @return A view whose scans walk the matrix forwards.
+ */
+FeatureView FeatureView::sorted() const
+{
+    std::vector<size_t> ordered = indices;
+    std::sort(ordered.begin(), ordered.end());
+    return source ? FeatureView(*source, std::move(ordered)) : FeatureView();
+}
@@ -0,0 +1,334 @@
+#include "../include/FeatureStore.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    constexpr char featureStoreMagic[8] = {'S', 'S', 'F', 'S', 'T', 'O', 'R', 'E'};
+    constexpr uint32_t featureStoreVersion = 1;
+
+    // Rounds an offset up to the next multiple of the given power-of-two alignment
+    uint64_t alignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    // Tells whether count items of itemSize bytes starting at offset lie within size bytes
+    // (without overflowing on corrupted values)
+    bool fitsIn(uint64_t offset, uint64_t count, uint64_t itemSize, uint64_t size)
+    {
+        return offset <= size && count <= (size - offset) / itemSize;
+    }
+
+    // Writes zero bytes until the stream position reaches the given offset
+    void padTo(std::ofstream &file, uint64_t offset)
+    {
+        static const char zeros[FeatureStore::alignment] = {};
+        uint64_t position = static_cast<uint64_t>(file.tellp());
+        while (position < offset)
+        {
+            uint64_t chunk = std::min<uint64_t>(offset - position, sizeof(zeros));
+            file.write(zeros, static_cast<std::streamsize>(chunk));
+            position += chunk;
+        }
+    }
+}
+
+/**
+ * @brief Opens and memory-maps the store file at the given path.
+ *
+ * @param path The path of a file produced by FeatureStore::write.
+ */
+FeatureStore::FeatureStore(const std::string &path)
+{
+    open(path);
+}
+
+FeatureStore::~FeatureStore()
+{
+    close();
+}
+
+FeatureStore::FeatureStore(FeatureStore &&other) noexcept
+{
+    *this = std::move(other);
+}
+
+FeatureStore &FeatureStore::operator=(FeatureStore &&other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        mapping = std::exchange(other.mapping, nullptr);
+        mappingSize = std::exchange(other.mappingSize, 0);
+        header = std::exchange(other.header, nullptr);
+        labels = std::exchange(other.labels, nullptr);
+        nameOffsets = std::exchange(other.nameOffsets, nullptr);
+        names = std::exchange(other.names, nullptr);
+        data = std::exchange(other.data, nullptr);
+    }
+    return *this;
+}
+
+/**
+ * @brief Packs a dataset into a single binary store file.
+ *
+ * The file starts with a FeatureStoreHeader, followed by the int32 labels, the table of
+ * source name offsets and the concatenated source names. The features are written last
+ * as a row-major block whose start and row stride are both aligned to 64 bytes, so that
+ * every mapped row can be handed to vectorized code without copying.
+ *
+ * @param path The output file path.
+ * @param points The samples to pack. All of them must have the same feature dimension.
+ * @param sourceNames The name of the file each sample was read from (same order as points).
+ * @param source The fingerprint of the directory the samples were read from, taken before
+ *               reading them (a file rewritten meanwhile then makes the store stale).
+ */
+void FeatureStore::write(const std::string &path,
+                         const std::vector<DataPoint> &points,
+                         const std::vector<std::string> &sourceNames,
+                         const SourceFingerprint &source)
+{
+    if (points.size() != sourceNames.size())
+    {
+        throw std::invalid_argument("Points and source names must have the same size.");
+    }
+
+    size_t dimension = points.empty() ? 0 : points[0].features.size();
+    for (const auto &point : points)
+    {
+        if (point.features.size() != dimension)
+        {
+            throw std::invalid_argument("All packed points must have the same feature dimension.");
+        }
+    }
+
+    // Compute the layout of the file
+    FeatureStoreHeader header{};
+    std::memcpy(header.magic, featureStoreMagic, sizeof(header.magic));
+    header.version = featureStoreVersion;
+    header.dimension = static_cast<uint32_t>(dimension);
+    header.count = points.size();
+    header.stride = alignUp(dimension * sizeof(double), alignment) / sizeof(double);
+    header.labelsOffset = sizeof(FeatureStoreHeader);
+    header.namesOffset = alignUp(header.labelsOffset + header.count * sizeof(int32_t), sizeof(uint64_t));
+    header.sourceFiles = source.files;
+    header.sourceBytes = source.bytes;
+    header.sourceNewestWrite = source.newestWrite;
+
+    std::vector<uint64_t> offsets(points.size() + 1, 0);
+    for (size_t i = 0; i < sourceNames.size(); ++i)
+    {
+        offsets[i + 1] = offsets[i] + sourceNames[i].size();
+    }
+    uint64_t namesEnd = header.namesOffset + offsets.size() * sizeof(uint64_t) + offsets.back();
+    header.dataOffset = alignUp(namesEnd, alignment);
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Failed to create feature store: " + path);
+    }
+
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    for (const auto &point : points)
+    {
+        int32_t label = point.label;
+        file.write(reinterpret_cast<const char *>(&label), sizeof(label));
+    }
+
+    padTo(file, header.namesOffset);
+    file.write(reinterpret_cast<const char *>(offsets.data()), static_cast<std::streamsize>(offsets.size() * sizeof(uint64_t)));
+    for (const auto &name : sourceNames)
+    {
+        file.write(name.data(), static_cast<std::streamsize>(name.size()));
+    }
+
+    // Rows are zero-padded up to the stride
+    padTo(file, header.dataOffset);
+    std::vector<double> paddedRow(header.stride, 0.0);
+    for (const auto &point : points)
+    {
+        std::copy(point.features.begin(), point.features.end(), paddedRow.begin());
+        file.write(reinterpret_cast<const char *>(paddedRow.data()), static_cast<std::streamsize>(paddedRow.size() * sizeof(double)));
+    }
+
+    if (!file.good())
+    {
+        throw std::runtime_error("Failed to write feature store: " + path);
+    }
+}
+
+/**
+ * @brief Memory-maps a store file and validates its header.
+ *
+ * The mapping is read-only and private; rows are accessed in place through row(). Every
+ * section (labels, name offsets, name blob, feature block) is checked to lie within the file,
+ * aligned, and the name offsets to be increasing, so a truncated or corrupted store is rejected
+ * instead of being read past its end.
+ *
+ * @param path The path of a file produced by FeatureStore::write.
+ */
+void FeatureStore::open(const std::string &path)
+{
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Failed to open feature store: " + path);
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(FeatureStoreHeader))
+    {
+        ::close(fd);
+        throw std::runtime_error("Invalid feature store: " + path);
+    }
+
+    void *address = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // The mapping stays valid after the descriptor is closed
+    if (address == MAP_FAILED)
+    {
+        throw std::runtime_error("Failed to map feature store: " + path);
+    }
+
+    mapping = address;
+    mappingSize = static_cast<size_t>(info.st_size);
+
+    const char *base = static_cast<const char *>(mapping);
+    header = reinterpret_cast<const FeatureStoreHeader *>(base);
+    const FeatureStoreHeader &layout = *header;
+    bool valid = std::memcmp(layout.magic, featureStoreMagic, sizeof(layout.magic)) == 0 &&
+                 layout.version == featureStoreVersion &&
+                 layout.stride >= layout.dimension && layout.stride <= mappingSize / sizeof(double) &&
+                 layout.labelsOffset >= sizeof(FeatureStoreHeader) && layout.labelsOffset % sizeof(int32_t) == 0 &&
+                 fitsIn(layout.labelsOffset, layout.count, sizeof(int32_t), mappingSize) &&
+                 layout.namesOffset % sizeof(uint64_t) == 0 && layout.count < std::numeric_limits<uint64_t>::max() &&
+                 fitsIn(layout.namesOffset, layout.count + 1, sizeof(uint64_t), mappingSize) &&
+                 layout.dataOffset % alignment == 0 &&
+                 (layout.stride == 0 || fitsIn(layout.dataOffset, layout.count, layout.stride * sizeof(double), mappingSize)) &&
+                 (layout.stride != 0 || layout.dataOffset <= mappingSize);
+    if (valid)
+    {
+        // Name offsets start at 0, never decrease, and end within the file
+        nameOffsets = reinterpret_cast<const uint64_t *>(base + layout.namesOffset);
+        uint64_t namesBegin = layout.namesOffset + (layout.count + 1) * sizeof(uint64_t);
+        valid = nameOffsets[0] == 0 && fitsIn(namesBegin, nameOffsets[layout.count], 1, mappingSize);
+        for (size_t i = 0; valid && i < layout.count; ++i)
+        {
+            valid = nameOffsets[i] <= nameOffsets[i + 1];
+        }
+    }
+    if (!valid)
+    {
+        close();
+        throw std::runtime_error("Corrupted or incompatible feature store: " + path);
+    }
+
+    labels = reinterpret_cast<const int32_t *>(base + header->labelsOffset);
+    names = reinterpret_cast<const char *>(nameOffsets + header->count + 1);
+    data = reinterpret_cast<const double *>(base + header->dataOffset);
+
+    // Hint the kernel that the feature block will be scanned sequentially
+    madvise(mapping, mappingSize, MADV_SEQUENTIAL);
+}
+
+/**
+ * @brief Unmaps the store, if any.
+ */
+void FeatureStore::close()
+{
+    if (mapping)
+    {
+        munmap(mapping, mappingSize);
+    }
+    mapping = nullptr;
+    mappingSize = 0;
+    header = nullptr;
+    labels = nullptr;
+    nameOffsets = nullptr;
+    names = nullptr;
+    data = nullptr;
+}
+
+/**
+ * @brief Returns the name of the file a row was packed from (e.g. "s01n001.art").
+ *
+ * @param index The row index.
+ * @return A view into the mapped name blob.
+ */
+std::string_view FeatureStore::sourceName(size_t index) const
+{
+    return std::string_view(names + nameOffsets[index], nameOffsets[index + 1] - nameOffsets[index]);
+}
+
+/**
+ * @brief Summarizes the descriptor files of a directory without reading them.
+ *
+ * Hidden files (e.g. .DS_Store) are ignored. A packed store records this summary, so a store
+ * that no longer matches its directory (files added, removed or rewritten) is detected.
+ *
+ * @param directory The method directory (e.g. ".../=Signatures/=ART").
+ * @return The number, total size and latest modification time of the files.
+ */
+SourceFingerprint FeatureStore::fingerprint(const std::string &directory)
+{
+    SourceFingerprint result;
+    for (const auto &file : std::filesystem::directory_iterator(directory))
+    {
+        if (!file.is_regular_file() || file.path().filename().string().rfind('.', 0) == 0)
+        {
+            continue;
+        }
+        int64_t written = file.last_write_time().time_since_epoch().count(); // May be negative (file clock epoch)
+        result.newestWrite = result.files == 0 ? written : std::max(result.newestWrite, written);
+        ++result.files;
+        result.bytes += file.file_size();
+    }
+    return result;
+}
+
+/**
+ * @brief Returns the fingerprint of the directory the store was packed from.
+ *
+ * @return The fingerprint recorded by write(); compare it with fingerprint()
+ *         of the directory to detect a stale store.
+ */
+SourceFingerprint FeatureStore::source() const
+{
+    SourceFingerprint result;
+    if (header)
+    {
+        result.files = header->sourceFiles;
+        result.bytes = header->sourceBytes;
+        result.newestWrite = header->sourceNewestWrite;
+    }
+    return result;
+}
+
+/**
+ * @brief Copies the mapped rows into DataPoints.
+ *
+ * @return One DataPoint per row, with its label and unpadded features.
+ */
+std::vector<DataPoint> FeatureStore::toDataPoints() const
+{
+    std::vector<DataPoint> points(size());
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+        points[i].label = label(i);
+        points[i].features.assign(row(i), row(i) + dimension());
+    }
+    return points;
+}
@@ -0,0 +1,163 @@
+#include "../include/SignatureLoader.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+/**
+ * @brief Extracts the class and sample numbers from a descriptor file name.
+ *
+ * Names follow the SharvitB2 convention "sXXnYYY.<ext>", e.g. "s07n012.gfd" is the 12th
+ * sample of class 7.
+ *
+ * @param fileName The file name (without directory).
+ * @param label Receives the class number XX.
+ * @param sample Receives the sample number YYY.
+ * @return true if the name follows the convention, false otherwise.
+ */
+bool SignatureLoader::parseSampleName(std::string_view fileName, int &label, int &sample)
+{
+    if (fileName.size() < 7 || fileName[0] != 's' || fileName[3] != 'n')
+    {
+        return false;
+    }
+
+    const char *begin = fileName.data();
+    auto [labelEnd, labelError] = std::from_chars(begin + 1, begin + 3, label);
+    auto [sampleEnd, sampleError] = std::from_chars(begin + 4, begin + 7, sample);
+    return labelError == std::errc() && labelEnd == begin + 3 &&
+           sampleError == std::errc() && sampleEnd == begin + 7;
+}
+
+/**
+ * @brief Parses whitespace-separated numbers with std::from_chars.
+ *
+ * This avoids the locale and stream state handling of operator>>, which dominated the
+ * cost of loading hundreds of small descriptor files.
+ *
+ * @param text The text to parse.
+ * @param values Receives the parsed values (cleared first).
+ * @return true if the whole buffer was parsed, false if a malformed token was found.
+ */
+bool SignatureLoader::parseValues(std::string_view text, std::vector<double> &values)
+{
+    values.clear();
+    const char *current = text.data();
+    const char *end = text.data() + text.size();
+
+    while (true)
+    {
+        // Skip the separators
+        while (current < end && std::isspace(static_cast<unsigned char>(*current)))
+        {
+            ++current;
+        }
+        if (current == end)
+        {
+            return true;
+        }
+
+        // from_chars does not accept a leading '+'
+        if (*current == '+')
+        {
+            ++current;
+        }
+
+        double value;
+        auto [next, error] = std::from_chars(current, end, value);
+        if (error != std::errc())
+        {
+            return false;
+        }
+        values.push_back(value);
+        current = next;
+    }
+}
+
+/**
+ * @brief Loads all descriptor files of a method directory.
+ *
+ * The directory is enumerated once; every file named "sXXnYYY.*" is read with a single
+ * buffered read, parsed, and labelled with its class number XX. Other files (e.g. .DS_Store)
+ * are ignored. Samples are returned sorted by file name so that the order is reproducible.
+ *
+ * @param methodPath The method directory (e.g. ".../=Signatures/=ART").
+ * @param sourceNames If not null, receives the file name of each returned sample.
+ * @return The loaded samples.
+ */
+std::vector<DataPoint> SignatureLoader::loadDirectory(const std::string &methodPath,
+                                                     std::vector<std::string> *sourceNames)
+{
+    struct Entry
+    {
+        std::string name;
+        std::filesystem::path path;
+        int label;
+    };
+
+    // Enumerate the directory once
+    std::vector<Entry> entries;
+    for (const auto &file : std::filesystem::directory_iterator(methodPath))
+    {
+        if (!file.is_regular_file())
+        {
+            continue;
+        }
+
+        std::string name = file.path().filename().string();
+        int label, sample;
+        if (parseSampleName(name, label, sample))
+        {
+            entries.push_back({std::move(name), file.path(), label});
+        }
+    }
+    std::sort(entries.begin(), entries.end(),
+              [](const Entry &a, const Entry &b)
+              { return a.name < b.name; });
+
+    std::vector<DataPoint> methodData;
+    methodData.reserve(entries.size());
+    if (sourceNames)
+    {
+        sourceNames->clear();
+        sourceNames->reserve(entries.size());
+    }
+
+    std::string buffer; // Reused across files
+    std::vector<double> values;
+    for (const auto &entry : entries)
+    {
+        // Read the whole file at once
+        std::ifstream file(entry.path, std::ios::binary);
+        if (!file.is_open())
+        {
+            std::cerr << "Warning: Unable to open file: " << entry.path.string() << std::endl;
+            continue;
+        }
+        file.seekg(0, std::ios::end);
+        buffer.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0, std::ios::beg);
+        file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+
+        if (!parseValues(buffer, values))
+        {
+            std::cerr << "Warning: Malformed descriptor file: " << entry.path.string() << std::endl;
+            continue;
+        }
+        if (values.empty())
+        {
+            continue;
+        }
+
+        methodData.push_back({entry.label, values});
+        if (sourceNames)
+        {
+            sourceNames->push_back(entry.name);
+        }
+    }
+
+    return methodData;
+}
@@ -1,6 +1,23 @@
-// Compile: g++ -std=c++17 -I../include main.cpp -o shape_recognition
+// Compile: g++ -std=c++17 -pthread -I../include main.cpp -o shape_recognition
 // Execute: ./shape_recognition
-// Both: g++ -std=c++17 -I../include main.cpp -o shape_recognition && ./shape_recognition
+// Pack the descriptors into binary stores once (faster startup): ./shape_recognition --pack
+// Compute a family from the PGM corpus instead of its text files: ./shape_recognition --native-zernike --native-gfd
+// Compare the native extractors with the shipped descriptor files: ./shape_recognition --validate-native
+// Search the KNN neighbours with a spatial index: ./shape_recognition --knn-index=kdtree (or balltree, hnsw, int8, pq, early, ivf, auto, brute)
+// Tune the HNSW graph: --hnsw-m=16 --hnsw-ef-construction=200 --hnsw-ef-search=50
+// Force narrower distance kernels (default: widest the CPU supports): --simd=avx2 (or sse2, portable, avx512)
+// Tune the compressed stores (int8, pq): --rerank=32 --pq-subspace-width=4 --pq-centroids=256
+// Transductive leave-one-out KNN accuracy of every K from 1 to 25 on every family: ./shape_recognition --knn-sweep=25
+// Compare HNSW with the exact scan on every family (recall and latency): ./shape_recognition --hnsw-report
+// Tune the IVF lists (default lists: square root of the training size): --ivf-lists=12 --nprobe=4
+// Compare IVF with the exact scan for growing nprobe: ./shape_recognition --ivf-report
+// Keep only KNN prototypes: --prototypes=enn (or cnn, enn+cnn, none)
+// Accuracy of anytime KNN predictions under candidate and time budgets: ./shape_recognition --anytime-report
+// Compression and accuracy of each prototype selection on every family: ./shape_recognition --prototype-report
+// Cost of KNN add/remove and agreement with a retrained KNN: ./shape_recognition --incremental-report --knn-index=kdtree
+// Check the exact searches and kernels against the portable brute-force scan: ./shape_recognition --self-test
+// Single precision: add -DUSE_FLOAT_SCALAR (float storage) and optionally -DUSE_FLOAT_ACCUMULATOR (float sums)
+// Both: g++ -std=c++17 -pthread -I../include main.cpp -o shape_recognition && ./shape_recognition
 
 #include <iostream>                              // for I/O operations like cout/cin
 #include <vector>                                // for dynamic arrays
@@ -8,11 +25,27 @@
 #include <fstream>                               // for file I/O (ifstream)
 #include <sstream>                               // for string streams
 #include <filesystem>                            // for file/directory operations
+#include <set>                                   // for option sets
 #include "../evaluator/ClassifierEvaluation.cpp" // includes evaluation functions
+#include "../classifier/Scaler.cpp"              // includes fitted feature scalers
+#include "../classifier/DistanceKernels.cpp"     // includes dispatched SIMD distance kernels
 #include "../classifier/KMeansClassifier.cpp"    // includes KMeans model
+#include "../classifier/NeighborIndex.cpp"       // includes KNN search structures
+#include "../classifier/QuantizedStore.cpp"      // includes compressed KNN reference stores
+#include "../classifier/IVFIndex.cpp"            // includes k-means inverted-file KNN index
+#include "../classifier/PrototypeSelection.cpp"  // includes condensed / edited KNN reference reduction
 #include "../classifier/KNNClassifier.cpp"       // includes KNN model
 #include "../classifier/SVMClassifier.cpp"       // includes SVM model
 #include "../classifier/MLPClassifier.cpp"       // includes MLP model
+#include "../classifier/Pipeline.cpp"            // includes scaler + classifier pipelines
+#include "../loader/FeatureStore.cpp"            // includes packed binary feature store
+#include "../loader/FeatureMatrix.cpp"           // includes contiguous aligned dataset
+#include "../loader/DatasetRegistry.cpp"         // includes load-once dataset cache
+#include "../loader/SignatureLoader.cpp"         // includes descriptor directory parser
+#include "../descriptor/PGMImage.cpp"            // includes PGM shape image reader
+#include "../descriptor/ShapePreprocessor.cpp"   // includes parallel PGM decoding and shape normalization
+#include "../descriptor/ZernikeExtractor.cpp"    // includes native Zernike moment extractor
+#include "../descriptor/GFDExtractor.cpp"        // includes native generic Fourier descriptor extractor
 #include "../include/DataPoint.h"                // custom class for storing data points
 
 // Utility function to check if a file exists
@@ -22,108 +55,819 @@ bool fileExists(const std::string &path)
     return file.good();               // Return true if file exists, false if not
 }
 
-// Function to format the file number (e.g., s01, s02, etc.)
-std::string formatFileNumber(int num)
+// Function to get the path of the packed binary store of a method (e.g. .../=ART.fstore)
+std::string getStorePath(const std::string &basePath, const std::string &method)
 {
-    std::string result = "s"; // Initialize string with 's' prefix
-    if (num < 10)             // If the number is less than 10, add leading zero
+    return basePath + method + ".fstore";
+}
+
+// Function to read data for a specific method and store it in a dedicated vector
+// (optionally also returns the name of the file each sample was read from)
+std::vector<DataPoint> loadMethodData(const std::string &basePath, const std::string &method,
+                                      std::vector<std::string> *sourceNames = nullptr)
+{
+    std::vector<DataPoint> methodData;          // Vector to store the data for the method
+    std::string methodPath = basePath + method; // Build path to method folder
+
+    if (!fileExists(methodPath)) // Check if the method folder exists
     {
-        result += "0";
+        std::cerr << "Error: Method path does not exist: " << methodPath << std::endl;
+        return methodData; // Return empty data if path is not found
     }
-    result += std::to_string(num); // Convert the number to a string and append
-    return result;                 // Return formatted string (e.g., "s01", "s02")
+
+    // Enumerate the folder and parse every sXXnYYY file (all classes, labels taken from XX)
+    methodData = SignatureLoader::loadDirectory(methodPath, sourceNames);
+    return methodData; // Return the vector containing all the method data
 }
 
-// Function to format the sample number (e.g., n001, n002, etc.)
-std::string formatSampleNumber(int sampleNum)
+// Function to read a method as a contiguous feature matrix (straight from the binary store when
+// packed, unless the store is unreadable or its directory changed since it was packed)
+FeatureMatrix loadMethodMatrix(const std::string &basePath, const std::string &method)
 {
-    std::ostringstream oss;                                       // Create an output string stream
-    oss << "n" << std::setw(3) << std::setfill('0') << sampleNum; // Format number with leading zeros
-    return oss.str();                                             // Return formatted sample number as string (e.g., "n001", "n002")
+    std::string storePath = getStorePath(basePath, method);
+    if (fileExists(storePath))
+    {
+        try
+        {
+            FeatureStore store(storePath); // Memory-map the store and copy its aligned block
+            std::string methodPath = basePath + method;
+            if (!fileExists(methodPath) || store.source() == FeatureStore::fingerprint(methodPath))
+            {
+                return FeatureMatrix(store);
+            }
+            std::cerr << "Warning: " << storePath << " no longer matches " << methodPath
+                      << "; reading the text files (run --pack to refresh it)" << std::endl;
+        }
+        catch (const std::runtime_error &error)
+        {
+            std::cerr << "Warning: " << error.what() << "; reading the text files (run --pack to rebuild it)" << std::endl;
+        }
+    }
+    return FeatureMatrix(loadMethodData(basePath, method));
 }
 
-// Function to get the file extension based on the method
-std::string getExtension(const std::string &method)
+// Function to compute a method's descriptors directly from the PGM corpus
+std::vector<DataPoint> extractNativeData(const std::string &corpusPath, const std::string &method)
 {
-    if (method == "ART")
-        return ".art";
-    if (method == "E34")
-        return ".e34";
-    if (method == "GFD")
-        return ".gfd";
-    if (method == "Yang")
-        return ".yng";
-    if (method == "Zernike7")
-        return ".zrk.txt";
-    return ""; // Return empty string if no match found
+    if (method == "=Zernike7")
+        return ZernikeExtractor().extractCorpus(corpusPath);
+    if (method == "=GFD")
+        return GFDExtractor().extractCorpus(corpusPath);
+    throw std::invalid_argument("No native extractor for method " + method);
 }
 
-// Function to read data for a specific method and store it in a dedicated vector
-std::vector<DataPoint> loadMethodData(const std::string &basePath, const std::string &method)
+// Largest relative L1 error (worst sample) a native family may show against its shipped files
+const double nativeTolerance = 0.05;
+
+// Function to compare the native extractors with the shipped descriptor files
+// (returns false if a family exceeds the tolerance)
+bool validateNativeFamilies(const std::string &basePath, const std::string &corpusPath)
 {
-    std::vector<DataPoint> methodData;          // Vector to store the data for the method
-    std::string methodPath = basePath + method; // Build path to method folder
+    bool passed = true;
+    for (const std::string method : {"=GFD", "=Zernike7"})
+    {
+        std::vector<std::string> shippedNames;
+        std::vector<DataPoint> shipped = loadMethodData(basePath, method, &shippedNames);
+        std::vector<DataPoint> native = extractNativeData(corpusPath, method);
+        std::vector<CorpusEntry> images = PGMImage::listCorpus(corpusPath); // Same order as the native samples
 
-    if (!fileExists(methodPath)) // Check if the method folder exists
+        // Relative L1 error of each sample present in both sets (matched on the "sXXnYYY" stem)
+        std::map<std::string, const DataPoint *> nativeByStem;
+        for (size_t i = 0; i < native.size(); ++i)
+        {
+            nativeByStem[images[i].name.substr(0, 7)] = &native[i];
+        }
+        std::vector<double> errors;
+        for (size_t i = 0; i < shipped.size(); ++i)
+        {
+            auto it = nativeByStem.find(shippedNames[i].substr(0, 7));
+            if (it == nativeByStem.end() || it->second->features.size() != shipped[i].features.size())
+            {
+                continue;
+            }
+            double difference = 0.0, reference = 0.0;
+            for (size_t j = 0; j < shipped[i].features.size(); ++j)
+            {
+                difference += std::abs(it->second->features[j] - shipped[i].features[j]);
+                reference += std::abs(shipped[i].features[j]);
+            }
+            errors.push_back(reference > 0 ? difference / reference : 0.0);
+        }
+
+        bool withinTolerance = !errors.empty() && errors.size() == shipped.size();
+        if (errors.empty())
+        {
+            std::cout << method << ": no comparable samples";
+        }
+        else
+        {
+            std::sort(errors.begin(), errors.end());
+            withinTolerance = withinTolerance && errors.back() <= nativeTolerance;
+            std::cout << method << ": " << errors.size() << "/" << shipped.size() << " samples, median relative error "
+                      << errors[errors.size() / 2] * 100 << "%, max " << errors.back() * 100 << "%";
+        }
+        std::cout << (withinTolerance ? " - PASS" : " - FAIL") << " (tolerance " << nativeTolerance * 100 << "%)" << std::endl;
+        passed = passed && withinTolerance;
+    }
+    return passed;
+}
+
+// Function to split a method for the reports: every 4th sample is a query, the others are
+// training samples; both are standardized with a scaler fitted on the training samples, as for KNN
+std::pair<FeatureMatrix, FeatureMatrix> loadReportSplit(const std::string &basePath, const std::string &method)
+{
+    FeatureMatrix data = loadMethodMatrix(basePath, method);
+    std::vector<size_t> trainPositions, queryPositions;
+    for (size_t i = 0; i < data.size(); ++i)
     {
-        std::cerr << "Error: Method path does not exist: " << methodPath << std::endl;
-        return methodData; // Return empty data if path is not found
+        (i % 4 == 0 ? queryPositions : trainPositions).push_back(i);
     }
+    FeatureView all(data);
+    StandardScaler scaler;
+    scaler.fit(all.subset(trainPositions));
+    FeatureMatrix train = all.subset(trainPositions).materialize();
+    FeatureMatrix queries = all.subset(queryPositions).materialize();
+    scaler.transform(train);
+    scaler.transform(queries);
+    return {std::move(train), std::move(queries)};
+}
 
-    // Loop through 10 classes (s01, s02, ..., s10)
-    for (int i = 1; i <= 10; ++i)
+// Function to find the k exact nearest training samples of every query by a full scan
+std::vector<std::vector<Neighbor>> exactNeighbors(const FeatureMatrix &train, const FeatureMatrix &queries, size_t k)
+{
+    std::vector<std::vector<Neighbor>> exact(queries.size());
+    for (size_t q = 0; q < queries.size(); ++q)
     {
-        for (int j = 1; j <= 12; ++j) // Loop through 12 samples per class
+        NeighborHeap heap(k);
+        for (size_t i = 0; i < train.size(); ++i)
         {
-            // Format the filename (e.g., s01n001.art, s01n002.art, ...)
-            std::string filename = formatFileNumber(i) + formatSampleNumber(j) + getExtension(method.substr(1));
-            std::string fullPath = methodPath + "/" + filename; // Full file path
+            heap.push(squaredEuclidean(queries.row(q), train.data(i), train.dimension()), i);
+        }
+        exact[q] = heap.sort();
+    }
+    return exact;
+}
 
-            std::ifstream file(fullPath); // Open the file
-            if (!file.is_open())          // Check if the file opened successfully
+// Function to search every query with an index (HNSWIndex, IVFIndex) and return the share of the
+// exact neighbours it found (recall@k), with the mean search latency in microsecondsPerQuery
+template <typename Index>
+double measureRecall(const Index &index, const FeatureMatrix &queries, const std::vector<std::vector<Neighbor>> &exact,
+                     size_t k, double &microsecondsPerQuery)
+{
+    size_t found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t q = 0; q < queries.size(); ++q)
+    {
+        NeighborHeap heap(k);
+        index.search(queries.row(q), heap);
+        for (const Neighbor &neighbor : heap.sort())
+        {
+            for (const Neighbor &reference : exact[q])
             {
-                std::cerr << "Warning: Unable to open file: " << fullPath << std::endl;
-                continue; // Skip this file if it cannot be opened
+                found += neighbor.second == reference.second;
             }
+        }
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    microsecondsPerQuery = elapsed.count() / queries.size();
+    return static_cast<double>(found) / (k * queries.size());
+}
+
+// Function to measure the recall and the latency of HNSW against the exact scan on every method
+// (split and scaled by loadReportSplit)
+void reportHNSWRecall(const std::string &basePath, const HNSWParameters &settings, size_t k)
+{
+    using Clock = std::chrono::steady_clock;
+    std::cout << "HNSW M=" << settings.M << ", efConstruction=" << settings.efConstruction << ", k=" << k << std::endl;
+    for (const std::string method : {"=ART", "=E34", "=GFD", "=Yang", "=Zernike7"})
+    {
+        auto [train, queries] = loadReportSplit(basePath, method);
+
+        auto start = Clock::now();
+        std::vector<std::vector<Neighbor>> exact = exactNeighbors(train, queries, k);
+        std::chrono::duration<double, std::micro> scanTime = Clock::now() - start;
+
+        HNSWIndex index;
+        start = Clock::now();
+        index.build(FeatureView(train), settings);
+        std::chrono::duration<double, std::milli> buildTime = Clock::now() - start;
+
+        std::cout << method << " (" << train.size() << " indexed, " << queries.size() << " queries, "
+                  << train.dimension() << " features): exact scan " << scanTime.count() / queries.size()
+                  << " us/query, graph built in " << buildTime.count() << " ms" << std::endl;
+        for (size_t efSearch : {10, 20, 40, 80, 160})
+        {
+            index.setEfSearch(efSearch);
+            double microsecondsPerQuery;
+            double recall = measureRecall(index, queries, exact, k, microsecondsPerQuery);
+            std::cout << "  efSearch " << efSearch << ": recall@" << k << " " << 100.0 * recall << "%, "
+                      << microsecondsPerQuery << " us/query" << std::endl;
+        }
+    }
+}
 
-            DataPoint point; // Create a DataPoint object to store features
-            point.label = i; // Assign the class label (1, 2, ..., 10)
-            double value;
-            while (file >> value) // Read each value in the file
+// Function to measure the recall and the latency of the IVF lists against the exact scan on every
+// method, for growing nprobe (split and scaled by loadReportSplit)
+void reportIVFRecall(const std::string &basePath, const IVFParameters &settings, size_t k)
+{
+    using Clock = std::chrono::steady_clock;
+    std::cout << "IVF k=" << k << std::endl;
+    for (const std::string method : {"=ART", "=E34", "=GFD", "=Yang", "=Zernike7"})
+    {
+        auto [train, queries] = loadReportSplit(basePath, method);
+
+        auto start = Clock::now();
+        std::vector<std::vector<Neighbor>> exact = exactNeighbors(train, queries, k);
+        std::chrono::duration<double, std::micro> scanTime = Clock::now() - start;
+
+        IVFIndex index;
+        start = Clock::now();
+        index.build(FeatureView(train), settings);
+        std::chrono::duration<double, std::milli> buildTime = Clock::now() - start;
+
+        std::cout << method << " (" << train.size() << " indexed, " << queries.size() << " queries, "
+                  << train.dimension() << " features): exact scan " << scanTime.count() / queries.size()
+                  << " us/query, " << index.listCount() << " lists built in " << buildTime.count() << " ms" << std::endl;
+        for (size_t nprobe = 1; nprobe <= index.listCount(); nprobe *= 2)
+        {
+            index.setNprobe(nprobe);
+            double microsecondsPerQuery;
+            double recall = measureRecall(index, queries, exact, k, microsecondsPerQuery);
+            std::cout << "  nprobe " << nprobe << ": recall@" << k << " " << 100.0 * recall << "%, "
+                      << microsecondsPerQuery << " us/query" << std::endl;
+        }
+    }
+}
+
+// Function to compare the prototype selections on every method: references kept, compression,
+// test accuracy and its change from the full reference set, and batch latency (split and scaled
+// by loadReportSplit)
+void reportPrototypeSelection(const std::string &basePath, int k)
+{
+    using Clock = std::chrono::steady_clock;
+    std::cout << "KNN prototype selection, K=" << k << std::fixed << std::setprecision(2) << std::endl;
+    for (const std::string method : {"=ART", "=E34", "=GFD", "=Yang", "=Zernike7"})
+    {
+        auto [train, queries] = loadReportSplit(basePath, method);
+
+        std::cout << method << " (" << train.size() << " training, " << queries.size() << " test samples)" << std::endl;
+        double fullAccuracy = 0.0;
+        for (PrototypeSelection selection : {PrototypeSelection::None, PrototypeSelection::Edited,
+                                             PrototypeSelection::Condensed, PrototypeSelection::EditedCondensed})
+        {
+            KNNClassifier knn(k, NeighborIndexType::BruteForce, HNSWParameters(), QuantizationParameters(),
+                              IVFParameters(), selection);
+            knn.train(FeatureView(train));
+            auto start = Clock::now();
+            std::vector<KNNPrediction> predictions = knn.classifyBatch(FeatureView(queries));
+            std::chrono::duration<double, std::micro> elapsed = Clock::now() - start;
+            size_t correct = 0;
+            for (size_t q = 0; q < queries.size(); ++q)
+            {
+                correct += predictions[q].label == queries.label(q);
+            }
+            double accuracy = 100.0 * correct / queries.size();
+            if (selection == PrototypeSelection::None)
             {
-                point.features.push_back(value); // Store the value in the features vector
+                fullAccuracy = accuracy;
             }
+            std::cout << "  " << std::left << std::setw(22) << prototypeSelectionName(selection) << std::right
+                      << std::setw(4) << knn.referenceCount() << " references ("
+                      << static_cast<double>(train.size()) / knn.referenceCount() << "x smaller), accuracy "
+                      << accuracy << "% (" << std::showpos << accuracy - fullAccuracy << std::noshowpos << "), "
+                      << elapsed.count() / queries.size() << " us/query" << std::endl;
+        }
+    }
+}
+
+// Function to measure anytime KNN predictions on every method: for each budget, the accuracy,
+// the agreement with the complete search, the share of searches that completed and the mean
+// latency (split and scaled by loadReportSplit)
+void reportAnytimeKNN(const std::string &basePath, int k)
+{
+    using Clock = std::chrono::steady_clock;
+    std::cout << "Anytime KNN, K=" << k << std::fixed << std::setprecision(2) << std::endl;
+    for (const std::string method : {"=ART", "=E34", "=GFD", "=Yang", "=Zernike7"})
+    {
+        auto [train, queries] = loadReportSplit(basePath, method);
+
+        KNNClassifier knn(k);
+        knn.train(FeatureView(train));
+        std::vector<int> complete(queries.size());
+        for (size_t q = 0; q < queries.size(); ++q)
+        {
+            complete[q] = knn.classify(queries.row(q)).label;
+        }
 
-            if (!point.features.empty()) // If the features vector is not empty
+        std::cout << method << " (" << train.size() << " training, " << queries.size() << " test samples)" << std::endl;
+        std::vector<std::pair<std::string, SearchBudget>> budgets;
+        for (size_t percent : {5, 10, 25, 50, 100})
+        {
+            SearchBudget budget;
+            budget.candidates = std::max<size_t>(1, train.size() * percent / 100);
+            budgets.emplace_back(std::to_string(budget.candidates) + " candidates", budget);
+        }
+        for (int microseconds : {1, 2, 5})
+        {
+            SearchBudget budget;
+            budget.time = std::chrono::microseconds(microseconds);
+            budgets.emplace_back(std::to_string(microseconds) + " us", budget);
+        }
+        for (const auto &[name, budget] : budgets)
+        {
+            size_t correct = 0, agreeing = 0, completed = 0;
+            auto start = Clock::now();
+            for (size_t q = 0; q < queries.size(); ++q)
             {
-                methodData.push_back(point); // Add the DataPoint to the methodData vector
+                AnytimePrediction result = knn.classifyWithin(queries.row(q), budget);
+                correct += result.prediction.label == queries.label(q);
+                agreeing += result.prediction.label == complete[q];
+                completed += result.completed;
             }
+            std::chrono::duration<double, std::micro> elapsed = Clock::now() - start;
+            std::cout << "  " << std::left << std::setw(16) << name << std::right << " accuracy "
+                      << 100.0 * correct / queries.size() << "%, same label as the full search "
+                      << 100.0 * agreeing / queries.size() << "%, completed " << 100.0 * completed / queries.size()
+                      << "%, " << elapsed.count() / queries.size() << " us/query" << std::endl;
+        }
+    }
+}
 
-            file.close(); // Close the file after reading
+// Function to measure incremental KNN updates on every method: half of the training samples
+// are trained on, the other half are added one at a time, then every 8th training sample is
+// removed; the predictions are compared with a KNN retrained on the live samples (split and
+// scaled by loadReportSplit)
+void reportIncrementalKNN(const std::string &basePath, NeighborIndexType index, const HNSWParameters &hnswSettings,
+                          const QuantizationParameters &quantizationSettings, const IVFParameters &ivfSettings, int k)
+{
+    using Clock = std::chrono::steady_clock;
+    std::cout << "Incremental KNN updates, K=" << k << std::fixed << std::setprecision(2) << std::endl;
+    for (const std::string method : {"=ART", "=E34", "=GFD", "=Yang", "=Zernike7"})
+    {
+        auto [train, queries] = loadReportSplit(basePath, method);
+
+        // Ids follow the training positions: the first half by train(), the rest by add()
+        std::vector<size_t> firstHalf(train.size() / 2);
+        std::iota(firstHalf.begin(), firstHalf.end(), 0);
+        FeatureMatrix initial = FeatureView(train).subset(firstHalf).materialize();
+        KNNClassifier knn(k, index, hnswSettings, quantizationSettings, ivfSettings);
+        knn.train(FeatureView(initial));
+
+        auto start = Clock::now();
+        for (size_t i = initial.size(); i < train.size(); ++i)
+        {
+            knn.add(train.row(i));
+        }
+        std::chrono::duration<double, std::micro> addTime = Clock::now() - start;
+        std::vector<size_t> livePositions;
+        start = Clock::now();
+        for (size_t i = 0; i < train.size(); ++i)
+        {
+            if (i % 8 == 0)
+            {
+                knn.remove(i);
+            }
+            else
+            {
+                livePositions.push_back(i);
+            }
+        }
+        std::chrono::duration<double, std::micro> removeTime = Clock::now() - start;
+
+        FeatureMatrix live = FeatureView(train).subset(livePositions).materialize();
+        KNNClassifier retrained(k, index, hnswSettings, quantizationSettings, ivfSettings);
+        start = Clock::now();
+        retrained.train(FeatureView(live));
+        std::chrono::duration<double, std::micro> retrainTime = Clock::now() - start;
+
+        size_t correct = 0, agreeing = 0;
+        for (size_t q = 0; q < queries.size(); ++q)
+        {
+            int label = knn.predict(queries.row(q));
+            correct += label == queries.label(q);
+            agreeing += label == retrained.predict(queries.row(q));
         }
+        size_t removed = train.size() - livePositions.size();
+        std::cout << method << ": " << train.size() - initial.size() << " adds, "
+                  << addTime.count() / (train.size() - initial.size()) << " us each; " << removed << " removals, "
+                  << removeTime.count() / removed << " us each; retrain " << retrainTime.count() << " us; "
+                  << knn.referenceCount() << " references, accuracy " << 100.0 * correct / queries.size()
+                  << "%, same label as the retrained KNN " << 100.0 * agreeing / queries.size() << "%" << std::endl;
     }
-    return methodData; // Return the vector containing all the method data
 }
 
-int main()
+// Function to print the transductive leave-one-out KNN accuracy of every K up to maxK on every
+// method: the scaler is fitted once on the whole method, left-out sample included, so the
+// accuracies are slightly optimistic compared with a scaler refitted for every left-out sample
+void reportKSweep(const std::string &basePath, int maxK)
+{
+    std::vector<std::string> methods = {"=ART", "=E34", "=GFD", "=Yang", "=Zernike7"};
+    std::vector<std::vector<double>> accuracies;
+    for (const std::string &method : methods)
+    {
+        FeatureMatrix data = loadMethodMatrix(basePath, method);
+        StandardScaler scaler;
+        scaler.fit(FeatureView(data));
+        scaler.transform(data);
+
+        auto start = std::chrono::steady_clock::now();
+        accuracies.push_back(ClassifierEvaluation::leaveOneOutKSweep(FeatureView(data), maxK));
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << method << ": " << data.size() << " samples, K = 1.." << accuracies.back().size()
+                  << " swept in " << elapsed.count() << " ms" << std::endl;
+    }
+
+    std::cout << "\nTransductive leave-one-out accuracy (%, scaler fitted on every sample)\n   K";
+    for (const std::string &method : methods)
+    {
+        std::cout << std::setw(10) << method;
+    }
+    std::cout << std::fixed << std::setprecision(2) << std::endl;
+    for (size_t k = 0; k < static_cast<size_t>(maxK); ++k)
+    {
+        std::cout << std::setw(4) << k + 1;
+        for (const std::vector<double> &accuracy : accuracies)
+        {
+            if (k < accuracy.size())
+                std::cout << std::setw(10) << accuracy[k];
+            else
+                std::cout << std::setw(10) << "-";
+        }
+        std::cout << std::endl;
+    }
+    std::cout << "Best K";
+    for (const std::vector<double> &accuracy : accuracies)
+    {
+        auto best = std::max_element(accuracy.begin(), accuracy.end()); // First K of the best accuracy
+        std::cout << std::setw(8) << (best - accuracy.begin()) + 1 << "  ";
+    }
+    std::cout << std::defaultfloat << std::endl;
+}
+
+// Function to count the classes of a dataset (labels run from 1 to the largest label)
+int countClasses(const FeatureMatrix &data)
+{
+    int numClasses = 0;
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        numClasses = std::max(numClasses, data.label(i));
+    }
+    return numClasses;
+}
+
+// Function to pack every method folder into its binary store (one-time conversion)
+void packAllMethods(const std::string &basePath)
+{
+    for (const std::string method : {"=ART", "=E34", "=GFD", "=Yang", "=Zernike7"})
+    {
+        std::vector<std::string> sourceNames;
+        SourceFingerprint source = FeatureStore::fingerprint(basePath + method); // Before reading the files
+        std::vector<DataPoint> methodData = loadMethodData(basePath, method, &sourceNames);
+        std::string storePath = getStorePath(basePath, method);
+        FeatureStore::write(storePath, methodData, sourceNames, source);
+        std::cout << "Packed " << methodData.size() << " samples into " << storePath << std::endl;
+    }
+}
+
+// Neighbourhood size used by the self-test
+const int selfTestK = 5;
+
+// Largest rounding difference between two SIMD levels, relative to the squared norms of the rows
+const Accum selfTestTolerance = std::sqrt(std::numeric_limits<Accum>::epsilon());
+
+// Function to print one self-test result (returns true if it passed)
+bool reportSelfTest(const std::string &method, const std::string &check, size_t failures, size_t queries)
+{
+    std::cout << method << " " << check << ": " << failures << "/" << queries << " queries differ"
+              << (failures == 0 ? " - PASS" : " - FAIL") << std::endl;
+    return failures == 0;
+}
+
+// Function to find the k nearest rows of a matrix by sorting every (squared distance, row)
+// pair: the portable reference of the self-test
+template <typename Row>
+std::vector<Neighbor> sortedNeighbors(const FeatureMatrix &references, const Row &query, size_t k)
+{
+    std::vector<Neighbor> neighbors;
+    for (size_t i = 0; i < references.size(); ++i)
+    {
+        neighbors.emplace_back(squaredEuclidean(query, references.data(i), references.dimension()), i);
+    }
+    std::sort(neighbors.begin(), neighbors.end());
+    neighbors.resize(std::min(k, neighbors.size()));
+    return neighbors;
+}
+
+// Function to check every neighbour search against a full sort of the distances, the batch
+// predictions against single ones, every SIMD level against the portable kernels and the
+// fixed-size kernels against the generic ones, with every sample of every family as a query
+// (returns false if any query gets a different result)
+bool runSelfTest(const std::string &basePath)
+{
+    bool passed = true;
+    for (const std::string method : {"=ART", "=E34", "=GFD", "=Yang", "=Zernike7"})
+    {
+        FeatureMatrix data = loadMethodMatrix(basePath, method);
+        FeatureView train = ClassifierEvaluation::splitTrainTest(data).first;
+        FeatureView queries(data);
+
+        // Same normalized training rows, in the same order, as the classifiers below
+        KNNClassifier::Scaler scaler;
+        scaler.fit(train);
+        FeatureMatrix references = train.materialize();
+        scaler.transform(references);
+        std::vector<std::vector<Neighbor>> expected;
+        for (const FeatureRow &query : queries)
+        {
+            expected.push_back(sortedNeighbors(references, scaler.bind(query), selfTestK));
+        }
+
+        for (NeighborIndexType type : {NeighborIndexType::BruteForce, NeighborIndexType::KDTree, NeighborIndexType::BallTree,
+                                       NeighborIndexType::EarlyAbandon})
+        {
+            Pipeline<KNNClassifier::Scaler, KNNClassifier> indexed(selfTestK, type);
+            indexed.train(train);
+            NeighborHeap heap;
+            size_t failures = 0;
+            for (size_t i = 0; i < queries.size(); ++i)
+            {
+                heap.reset(selfTestK);
+                indexed.classifier().searchNeighbors(indexed.scaler().bind(queries.row(i)), heap);
+                failures += heap.sort() != expected[i];
+            }
+            passed = reportSelfTest(method, neighborIndexName(type), failures, queries.size()) && passed;
+        }
+
+        // The blocked batch scan must predict exactly what one query at a time predicts
+        FeatureMatrix normalizedQueries = queries.materialize();
+        scaler.transform(normalizedQueries);
+        KNNClassifier knn(selfTestK);
+        knn.train(FeatureView(references));
+        std::vector<KNNPrediction> batch = knn.classifyBatch(FeatureView(normalizedQueries));
+        size_t failures = 0;
+        for (size_t i = 0; i < normalizedQueries.size(); ++i)
+        {
+            KNNPrediction single = knn.classify(normalizedQueries.row(i));
+            failures += single.label != batch[i].label || single.vote != batch[i].vote || single.score != batch[i].score;
+        }
+        passed = reportSelfTest(method, "batch", failures, queries.size()) && passed;
+
+        // Every SIMD level must agree with the portable kernels up to rounding: same kernel
+        // values, and the same neighbours unless two of them are within rounding of each other
+        SimdLevel selected = activeSimdLevel();
+        setSimdLevel(SimdLevel::Portable);
+        std::vector<std::vector<Neighbor>> portableNeighbors;
+        std::vector<Accum> portableValues; // squaredL2, manhattanL1 and dotProduct of every pair
+        for (size_t i = 0; i < normalizedQueries.size(); ++i)
+        {
+            portableNeighbors.push_back(sortedNeighbors(references, normalizedQueries.row(i), selfTestK));
+            for (size_t j = 0; j < references.size(); ++j)
+            {
+                const Scalar *a = normalizedQueries.data(i), *b = references.data(j);
+                portableValues.push_back(squaredL2(a, b, data.dimension()));
+                portableValues.push_back(manhattanL1(a, b, data.dimension()));
+                portableValues.push_back(dotProduct(a, b, data.dimension()));
+            }
+        }
+        for (SimdLevel level : {SimdLevel::Portable, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512})
+        {
+            if (level > detectSimdLevel())
+            {
+                break;
+            }
+            setSimdLevel(level);
+
+            // A kernel specialized for the dimension must return the generic kernel's distances
+            RowKernel specialized = squaredL2Kernel(data.dimension()), generic = genericSquaredL2Kernel();
+            if (specialized != generic)
+            {
+                failures = 0;
+                for (size_t i = 0; i < normalizedQueries.size(); ++i)
+                {
+                    bool identical = true;
+                    for (size_t j = 0; j < references.size(); ++j)
+                    {
+                        const Scalar *a = normalizedQueries.data(i), *b = references.data(j);
+                        identical = identical && specialized(a, b, data.dimension()) == generic(a, b, data.dimension());
+                    }
+                    failures += !identical;
+                }
+                passed = reportSelfTest(method, "fixed-size kernel " + simdLevelName(level), failures, queries.size()) && passed;
+            }
+            if (level == SimdLevel::Portable)
+            {
+                continue;
+            }
+
+            failures = 0;
+            for (size_t i = 0; i < normalizedQueries.size(); ++i)
+            {
+                const Scalar *a = normalizedQueries.data(i);
+                Accum queryNorm = dotProduct(a, a, data.dimension());
+                auto close = [&](Accum value, Accum reference, const Scalar *b)
+                {
+                    return std::abs(value - reference) <= selfTestTolerance * (1 + queryNorm + dotProduct(b, b, data.dimension()));
+                };
+                bool agrees = true;
+                for (size_t j = 0; j < references.size(); ++j)
+                {
+                    const Scalar *b = references.data(j);
+                    const Accum *values = &portableValues[3 * (i * references.size() + j)];
+                    agrees = agrees && close(squaredL2(a, b, data.dimension()), values[0], b) &&
+                             close(manhattanL1(a, b, data.dimension()), values[1], b) &&
+                             close(dotProduct(a, b, data.dimension()), values[2], b);
+                }
+                std::vector<Neighbor> neighbors = sortedNeighbors(references, normalizedQueries.row(i), selfTestK);
+                for (size_t r = 0; r < neighbors.size(); ++r)
+                {
+                    const Neighbor &reference = portableNeighbors[i][r];
+                    agrees = agrees && (neighbors[r].second == reference.second ||
+                                        close(neighbors[r].first, reference.first, references.data(reference.second)));
+                }
+                failures += !agrees;
+            }
+            passed = reportSelfTest(method, "SIMD " + simdLevelName(level), failures, queries.size()) && passed;
+        }
+        setSimdLevel(selected);
+    }
+    return passed;
+}
+
+int main(int argc, char *argv[])
 {
     int kFolds = 10;
     try
     {
-        bool continueRunning = true; // Flag to control the loop
+        // Base paths to the dataset
+        std::string basePath = "../data/=SharvitB2/=SharvitB2/=Signatures/";
+        std::string corpusPath = "../data/=SharvitB2/=SharvitB2/=Corpus/pgm";
 
-        while (continueRunning)
+        // Command-line options
+        std::set<std::string> nativeFamilies; // Families computed from the PGM images
+        NeighborIndexType knnIndex = NeighborIndexType::BruteForce;
+        HNSWParameters hnswSettings;
+        bool hnswReport = false;
+        QuantizationParameters quantizationSettings;
+        IVFParameters ivfSettings;
+        bool ivfReport = false;
+        PrototypeSelection prototypes = PrototypeSelection::None;
+        bool prototypeReport = false;
+        bool anytimeReport = false;
+        bool incrementalReport = false;
+        int sweepMaxK = 0; // Largest K of the transductive leave-one-out sweep (0: no sweep)
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string option = argv[i];
+            if (option == "--pack")
+            {
+                // Convert the text descriptors into binary stores and exit
+                packAllMethods(basePath);
+                return 0;
+            }
+            else if (option == "--native-zernike")
+            {
+                nativeFamilies.insert("=Zernike7"); // Featurize the PGM images instead of reading .zrk.txt files
+            }
+            else if (option == "--native-gfd")
+            {
+                nativeFamilies.insert("=GFD"); // Featurize the PGM images instead of reading .gfd files
+            }
+            else if (option.rfind("--knn-index=", 0) == 0)
+            {
+                knnIndex = parseNeighborIndexType(option.substr(12)); // Neighbour search used by KNN
+            }
+            else if (option.rfind("--hnsw-m=", 0) == 0)
+            {
+                hnswSettings.M = std::stoul(option.substr(9)); // Links per node of the HNSW graph
+            }
+            else if (option.rfind("--hnsw-ef-construction=", 0) == 0)
+            {
+                hnswSettings.efConstruction = std::stoul(option.substr(23)); // Candidates per insertion
+            }
+            else if (option.rfind("--hnsw-ef-search=", 0) == 0)
+            {
+                hnswSettings.efSearch = std::stoul(option.substr(17)); // Candidates per query
+            }
+            else if (option.rfind("--rerank=", 0) == 0)
+            {
+                quantizationSettings.rerank = std::stoul(option.substr(9)); // Candidates re-ranked exactly
+            }
+            else if (option.rfind("--pq-subspace-width=", 0) == 0)
+            {
+                quantizationSettings.subspaceWidth = std::stoul(option.substr(20)); // Features per PQ subspace
+            }
+            else if (option.rfind("--pq-centroids=", 0) == 0)
+            {
+                quantizationSettings.centroids = std::stoul(option.substr(15)); // Codewords per PQ subspace
+                if (quantizationSettings.centroids < 1 || quantizationSettings.centroids > 256)
+                {
+                    std::cerr << "--pq-centroids must be between 1 and 256 (codes are one byte)" << std::endl;
+                    return 1;
+                }
+            }
+            else if (option.rfind("--ivf-lists=", 0) == 0)
+            {
+                ivfSettings.lists = std::stoul(option.substr(12)); // k-means clusters of the IVF index
+            }
+            else if (option.rfind("--nprobe=", 0) == 0)
+            {
+                ivfSettings.nprobe = std::stoul(option.substr(9)); // IVF lists scanned per query
+            }
+            else if (option.rfind("--prototypes=", 0) == 0)
+            {
+                prototypes = parsePrototypeSelection(option.substr(13)); // Reduction of the KNN references
+            }
+            else if (option.rfind("--simd=", 0) == 0)
+            {
+                SimdLevel level = setSimdLevel(parseSimdLevel(option.substr(7))); // Instruction set of the kernels
+                std::cout << "Distance kernels: " << simdLevelName(level) << " (CPU supports "
+                          << simdLevelName(detectSimdLevel()) << ")" << std::endl;
+            }
+            else if (option.rfind("--knn-sweep=", 0) == 0)
+            {
+                sweepMaxK = std::stoi(option.substr(12)); // Run once every option is parsed
+            }
+            else if (option == "--hnsw-report")
+            {
+                hnswReport = true; // Run once the HNSW settings are all parsed
+            }
+            else if (option == "--ivf-report")
+            {
+                ivfReport = true; // Run once the IVF settings are all parsed
+            }
+            else if (option == "--prototype-report")
+            {
+                prototypeReport = true;
+            }
+            else if (option == "--anytime-report")
+            {
+                anytimeReport = true;
+            }
+            else if (option == "--incremental-report")
+            {
+                incrementalReport = true; // Run once the KNN index is parsed
+            }
+            else if (option == "--self-test")
+            {
+                return runSelfTest(basePath) ? 0 : 1;
+            }
+            else if (option == "--validate-native")
+            {
+                return validateNativeFamilies(basePath, corpusPath) ? 0 : 1;
+            }
+            else
+            {
+                std::cerr << "Unknown option: " << option << std::endl;
+                return 1;
+            }
+        }
+
+        if (sweepMaxK > 0)
+        {
+            reportKSweep(basePath, sweepMaxK);
+            return 0;
+        }
+        if (hnswReport)
+        {
+            reportHNSWRecall(basePath, hnswSettings, 3);
+            return 0;
+        }
+        if (ivfReport)
+        {
+            reportIVFRecall(basePath, ivfSettings, 3);
+            return 0;
+        }
+        if (prototypeReport)
+        {
+            reportPrototypeSelection(basePath, 3);
+            return 0;
+        }
+        if (anytimeReport)
+        {
+            reportAnytimeKNN(basePath, 3);
+            return 0;
+        }
+        if (incrementalReport)
         {
-            // Base path to the dataset
-            std::string basePath = "../data/=SharvitB2/=SharvitB2/=Signatures/";
+            reportIncrementalKNN(basePath, knnIndex, hnswSettings, quantizationSettings, ivfSettings, 3);
+            return 0;
+        }
+
+        bool continueRunning = true; // Flag to control the loop
 
-            // Load the data for each method
-            std::vector<DataPoint> artData = loadMethodData(basePath, "=ART");
-            std::vector<DataPoint> e34Data = loadMethodData(basePath, "=E34");
-            std::vector<DataPoint> gfdData = loadMethodData(basePath, "=GFD");
-            std::vector<DataPoint> yangData = loadMethodData(basePath, "=Yang");
-            std::vector<DataPoint> zernike7Data = loadMethodData(basePath, "=Zernike7");
+        // Each method is loaded once for the whole session; start all of them in the background
+        // so that disk reads overlap with each other and with the menu below
+        DatasetRegistry registry([&](const std::string &method)
+                                 {
+                                     if (nativeFamilies.count(method))
+                                     {
+                                         return FeatureMatrix(extractNativeData(corpusPath, method));
+                                     }
+                                     return loadMethodMatrix(basePath, method); });
+        registry.prefetch({"=ART", "=E34", "=GFD", "=Yang", "=Zernike7"});
 
+        while (continueRunning)
+        {
             // Data Preparation Strategy Menu
             std::cout << "\nChoose Data Preparation Strategy:" << std::endl;
             std::cout << "1. Standard Split and Train" << std::endl;
@@ -134,12 +878,23 @@ int main()
             int preparationChoice;
             std::cin >> preparationChoice;
 
-            // Declare vectors to store prepared data for each method
-            std::vector<DataPoint> artTrainData, artTestData;
-            std::vector<DataPoint> e34TrainData, e34TestData;
-            std::vector<DataPoint> gfdTrainData, gfdTestData;
-            std::vector<DataPoint> yangTrainData, yangTestData;
-            std::vector<DataPoint> zernike7TrainData, zernike7TestData;
+            // Get the data for each method (waits for the background loads on the first loop only)
+            const FeatureMatrix &artData = registry.get("=ART");
+            const FeatureMatrix &e34Data = registry.get("=E34");
+            const FeatureMatrix &gfdData = registry.get("=GFD");
+            const FeatureMatrix &yangData = registry.get("=Yang");
+            const FeatureMatrix &zernike7Data = registry.get("=Zernike7");
+            int numClasses = countClasses(artData);
+
+            // Declare views selecting the prepared data of each method (no feature is copied)
+            FeatureView artTrainData, artTestData;
+            FeatureView e34TrainData, e34TestData;
+            FeatureView gfdTrainData, gfdTestData;
+            FeatureView yangTrainData, yangTestData;
+            FeatureView zernike7TrainData, zernike7TestData;
+
+            // Training sets extended with noisy samples (only filled by the augmentation strategy)
+            FeatureMatrix artAugmented, e34Augmented, gfdAugmented, yangAugmented, zernike7Augmented;
 
             // Switch statement to handle different data preparation strategies
             switch (preparationChoice)
@@ -170,11 +925,16 @@ int main()
                 std::cout << "Enter the fraction of data to augment (recommended 0.5): ";
                 std::cin >> augmentationFraction;
                 // Ajouter du bruit et augmenter la taille des données d'entrainement
-                artTrainData = ClassifierEvaluation::augmentNoise(artTrainData, noiseLevel, augmentationFraction);
-                e34TrainData = ClassifierEvaluation::augmentNoise(e34TrainData, noiseLevel, augmentationFraction);
-                gfdTrainData = ClassifierEvaluation::augmentNoise(gfdTrainData, noiseLevel, augmentationFraction);
-                yangTrainData = ClassifierEvaluation::augmentNoise(yangTrainData, noiseLevel, augmentationFraction);
-                zernike7TrainData = ClassifierEvaluation::augmentNoise(zernike7TrainData, noiseLevel, augmentationFraction);
+                artAugmented = ClassifierEvaluation::augmentNoise(artTrainData, noiseLevel, augmentationFraction);
+                e34Augmented = ClassifierEvaluation::augmentNoise(e34TrainData, noiseLevel, augmentationFraction);
+                gfdAugmented = ClassifierEvaluation::augmentNoise(gfdTrainData, noiseLevel, augmentationFraction);
+                yangAugmented = ClassifierEvaluation::augmentNoise(yangTrainData, noiseLevel, augmentationFraction);
+                zernike7Augmented = ClassifierEvaluation::augmentNoise(zernike7TrainData, noiseLevel, augmentationFraction);
+                artTrainData = artAugmented;
+                e34TrainData = e34Augmented;
+                gfdTrainData = gfdAugmented;
+                yangTrainData = yangAugmented;
+                zernike7TrainData = zernike7Augmented;
                 break;
             }
             case 3:
@@ -183,7 +943,7 @@ int main()
                 std::cout << "Enter number of folds (recommended 5 or 10): ";
                 std::cin >> kFolds;
 
-                // /!\ Warning: For K-Fold, we'll use full datasets instead of train/test split
+                // /!\ Warning: For K-Fold, we'll use full datasets instead of train/test split (views of every row)
                 artTrainData = artData;
                 e34TrainData = e34Data;
                 gfdTrainData = gfdData;
@@ -223,8 +983,8 @@ int main()
                 ClassifierEvaluation evaluator;
 
                 // Lambda function to process a single dataset
-                auto processDataset = [&](const std::vector<DataPoint> &trainData,
-                                          const std::vector<DataPoint> &testData,
+                auto processDataset = [&](const FeatureView &trainData,
+                                          const FeatureView &testData,
                                           const std::string &datasetName)
                 {
                     if (preparationChoice == 3)
@@ -264,7 +1024,7 @@ int main()
             case 1:
             {
                 // Initialize and apply KMeans classifier
-                KMeansClassifier kmeans(10, 100);
+                Pipeline<KMeansClassifier::Scaler, KMeansClassifier> kmeans(numClasses, 100);
                 std::cout << "Starting KMeans..." << std::endl;
                 applyClassifierToAllData(kmeans, "KMeans");
                 break;
@@ -275,7 +1035,7 @@ int main()
                 int kValue;
                 std::cout << "Enter the value of K for KNN: ";
                 std::cin >> kValue;
-                KNNClassifier knn(kValue);
+                Pipeline<KNNClassifier::Scaler, KNNClassifier> knn(kValue, knnIndex, hnswSettings, quantizationSettings, ivfSettings, prototypes);
                 std::cout << "Starting KNN..." << std::endl;
                 applyClassifierToAllData(knn, "KNN");
                 break;
@@ -283,7 +1043,7 @@ int main()
             case 3:
             {
                 // Initialize and apply SVM classifier
-                SVMClassifier svm(0.1, 1000);
+                Pipeline<SVMClassifier::Scaler, SVMClassifier> svm(0.1, 1000);
                 std::cout << "Starting SVM..." << std::endl;
                 applyClassifierToAllData(svm, "SVM");
                 break;
@@ -291,12 +1051,11 @@ int main()
             case 4:
             {
                 // Initialize and apply MLP classifier
-                int numClasses = 10;
-                int inputSize = artTrainData[0].features.size();
-                int outputSize = numClasses;
+                int inputSize = artTrainData.dimension();
+                int outputSize = numClasses + 1; // Labels (1..numClasses) are used as output indices
                 int hiddenSize = 50;
 
-                MLPClassifier mlp(inputSize, hiddenSize, outputSize);
+                Pipeline<MLPClassifier::Scaler, MLPClassifier> mlp(inputSize, hiddenSize, outputSize);
                 std::cout << "Starting MLP..." << std::endl;
                 applyClassifierToAllData(mlp, "MLP");
                 break;